@@ -1,15 +1,24 @@
 #include "ai.h"
+#include <algorithm>
 #include "entities.h"
 #include "gamelogic.h"
 #include "graphics.h"
 #include "level.h"
+#include "lineofsight.h"
+#include "navigation.h"
 #include "physics.h"
+#include "savestate.h"
 #include "state.h"
 #include "tiles.h"
 #include "utils.h"
 
 RandomGenerator ai_rg;
 
+// the longest an AI goes without checking the distance to its target
+extern double const MAX_THINK_PERIOD = SecToTicks(0.05);
+// timers run out once they drop below 0, not when they land on it
+double const TIMER_EPSILON = 1e-6;
+
 BaseAI::BaseAI(Creature *c)
 {
 	for (int timers = 0; timers < (int)timeToTrigger.size(); timers++)
@@ -19,7 +28,35 @@ BaseAI::BaseAI(Creature *c)
 	target = Game::GetPlayer();
 }
 
-void BaseAI::RunAI(double ticks)
+BaseAI* CreateAI(std::string name, Creature *c)
+{
+	if(name == "Chaser")
+		return new AI_Chaser(c);
+	if(name == "ChaserJumper")
+		return new AI_ChaserJumper(c);
+	if(name == "Wanderer")
+		return new AI_Wanderer(c);
+	if(name == "Idle")
+		return new AI_Idle(c);
+	if(name == "HomingMissile")
+		return new AI_HomingMissile(c);
+	if(name == "Hypno")
+		return new AI_Hypno(c);
+	if(name == "Liner")
+		return new AI_Liner(c);
+	if(name == "Sentinel")
+		return new AI_Sentinel(c);
+	if(name == "Anvil")
+		return new AI_Anvil(c);
+	if(name == "Jumpingfire")
+		return new AI_Jumpingfire(c);
+	if(name == "GroundShockwaver")
+		return new AI_GroundShockwaver(c);
+	return nullptr;
+}
+
+// Range flags come from AIScheduler, which checks every thinker at once
+void BaseAI::RunAI(double ticks, bool inReach, bool outOfReach)
 {
 	for (int i = 0; i < (int)timeToTrigger.size(); i++)
 	{
@@ -31,7 +68,7 @@ void BaseAI::RunAI(double ticks)
 		}
 	}	
 
-	if(me->GetDistanceToEntity(target) < distanceToReach && me->GetXDistanceToEntity(target) < distanceToReachX && me->GetYDistanceToEntity(target) < distanceToReachY)
+	if(inReach)
 	{
 		if(!distanceReached)
 		{
@@ -40,7 +77,7 @@ void BaseAI::RunAI(double ticks)
 			distanceReached = true;
 		}
 	}
-	else if(me->GetDistanceToEntity(target) > distanceToLoss)
+	else if(outOfReach)
 	{
 		if(oneTimeToggle)
 			return;
@@ -53,9 +90,67 @@ void BaseAI::RunAI(double ticks)
 	}
 }
 
+AIRanges BaseAI::GetRanges()
+{
+	AIRanges r;
+	// a distance can't be below a negative range, but is always above one
+	r.reachSquared = distanceToReach > 0 ? (double)distanceToReach * distanceToReach : -1;
+	r.reachX = distanceToReachX;
+	r.reachY = distanceToReachY;
+	r.lossSquared = distanceToLoss >= 0 ? (double)distanceToLoss * distanceToLoss : -1;
+	return r;
+}
+
+// Nothing happens between timer triggers except distance checks, so the
+// next think is when the first timer runs out, or the next distance check
+double BaseAI::GetTimeUntilThink()
+{
+	double until = MAX_THINK_PERIOD;
+	for(auto t : timerTime)
+		until = std::min(until, t + TIMER_EPSILON);
+	return std::max(0.0, until);
+}
+
 void BaseAI::Trigger(int id)
 {
 	timerTime[id] = 0;
+	untilThink = 0;
+}
+
+// The target isn't saved, it's always the player.
+// The navigation profile is looked up again when needed
+void BaseAI::SaveState(StateWriter &w)
+{
+	w.Write(distanceReached);
+	w.WriteVector(path);
+	w.Write(pathGoal);
+	w.WriteVector(targetPos);
+	w.WriteVector(timerTime);
+	w.WriteVector(timeToTrigger);
+	w.Write(distanceToLoss);
+	w.Write(distanceToReach);
+	w.Write(distanceToReachX);
+	w.Write(distanceToReachY);
+	w.Write(scheduled);
+	w.Write(pendingTicks);
+	w.Write(untilThink);
+}
+
+void BaseAI::LoadState(StateReader &r)
+{
+	r.Read(distanceReached);
+	r.ReadVector(path);
+	r.Read(pathGoal);
+	r.ReadVector(targetPos);
+	r.ReadVector(timerTime);
+	r.ReadVector(timeToTrigger);
+	r.Read(distanceToLoss);
+	r.Read(distanceToReach);
+	r.Read(distanceToReachX);
+	r.Read(distanceToReachY);
+	r.Read(scheduled);
+	r.Read(pendingTicks);
+	r.Read(untilThink);
 }
 
 void BaseAI::Wander()
@@ -84,6 +179,70 @@ void BaseAI::TurnToTarget()
 		me->direction = DIRECTION_LEFT;
 }
 
+int BaseAI::GetNavProfile()
+{
+	if(navProfile < 0)
+		navProfile = Navigation::GetProfileID(Navigation::GetProfile(*me));
+	return navProfile;
+}
+
+// Next move on the way to the target. Chasing the player is a lookup in the
+// shared flow field, other targets get a path of their own
+bool BaseAI::FindNextStep(int from, NavStep &next)
+{
+	// the player is chased with the shared flow field, and with a path of
+	// its own while the field is made again after the level changed
+	if(target == Game::GetPlayer())
+	{
+		NAV_RESULTS result = Navigation::GetFlowStep(GetNavProfile(), from, next);
+		if(result != NAV_DEFERRED)
+			return result == NAV_FOUND;
+	}
+
+	int goal = Navigation::FindNodeBelow(*target);
+	if(goal < 0)
+		return false;
+	// keep following the current path while the target stays on the same node
+	auto step = std::find_if(path.begin(), path.end(), [from](const NavStep &s) { return s.node == from; });
+	if(goal != pathGoal || step == path.end())
+	{
+		if(Navigation::FindPath(GetNavProfile(), from, goal, path) != NAV_FOUND)
+		{
+			path.clear();
+			pathGoal = -1;
+			return false;
+		}
+		pathGoal = goal;
+		step = path.begin();
+	}
+	// already there
+	if(step + 1 == path.end())
+		return false;
+	next = *(step + 1);
+	return true;
+}
+
+// Steers towards the target along the navigation graph, jumping where the path
+// says so. Returns false when there is no path to follow right now
+bool BaseAI::FollowPathToTarget()
+{
+	int from = Navigation::FindStandingNode(*me);
+	NavStep next;
+	if(from < 0 || !FindNextStep(from, next))
+		return false;
+
+	me->SetDirection(Navigation::GetNode(next.node).x < Navigation::GetNode(from).x ? DIRECTION_LEFT : DIRECTION_RIGHT);
+	me->Walk();
+	if(next.move == NAV_MOVE_JUMP && me->state->Is(CREATURE_STATES::ONGROUND))
+		me->SetState(CREATURE_STATES::JUMPING);
+	return true;
+}
+
+bool BaseAI::CanSeeTarget()
+{
+	return LineOfSight::CanSee(*me, *target);
+}
+
 void AI_Chaser::OnDistanceReached()
 {
 	chase = true;
@@ -102,6 +261,8 @@ void AI_Chaser::OnTimerTimeup(int id)
 
 	bool jumpEnabled = true;
 
+	if(chase && FollowPathToTarget())
+		return;
 	if(chase)
 	{
 		if(me->state->Is(CREATURE_STATES::ONGROUND) || followTargetInAir)
@@ -147,6 +308,14 @@ void AI_ChaserJumper::OnDistanceLost()
 
 void AI_ChaserJumper::OnTimerTimeup(int id)
 {
+	if(chase && FollowPathToTarget())
+	{
+		// still leaps at the target once close enough
+		int distX = (int)me->GetXDistanceToEntity(target);
+		if(distX < distanceToJumpFrom + threshold && distX > distanceToJumpFrom - threshold)
+			me->SetState(CREATURE_STATES::JUMPING);
+		return;
+	}
 	if(chase)
 	{
 		if(me->state->Is(CREATURE_STATES::ONGROUND) || followTargetInAir)
@@ -201,7 +370,12 @@ void AI_HomingMissile::OnTimerTimeup(int id)
 
 	if (id == AI_TIMER_REACH)
 	{
-		if (me->GetX() < target->GetX())
+		// flies around walls the way the shared flow field goes when low enough to use it
+		int from = Navigation::FindNodeBelow(*me);
+		NavStep next;
+		if(from >= 0 && FindNextStep(from, next))
+			me->SetDirection(Navigation::GetNode(next.node).x < Navigation::GetNode(from).x ? DIRECTION_LEFT : DIRECTION_RIGHT);
+		else if (me->GetX() < target->GetX())
 			me->SetDirection(DIRECTION_RIGHT);
 		else
 			me->SetDirection(DIRECTION_LEFT);
@@ -212,7 +386,7 @@ void AI_HomingMissile::OnTimerTimeup(int id)
 		else
 			me->MoveUp();
 	}
-	if (id == AI_TIMER_SHOOT)
+	if (id == AI_TIMER_SHOOT && CanSeeTarget())
 	{
 		me->Shoot();
 	}
@@ -246,7 +420,7 @@ void AI_Sentinel::OnDistanceReached()
 
 void AI_Sentinel::OnTimerTimeup(int id)
 {
-	if(activated)
+	if(activated && CanSeeTarget())
 	{
 		this->TurnToTarget();
 		me->Shoot();
@@ -285,7 +459,7 @@ void AI_GroundShockwaver::OnTimerTimeup(int id)
 		return;
 
 	this->TurnToTarget();
-	if(id == AI_TIMER_SHOOT)
+	if(id == AI_TIMER_SHOOT && CanSeeTarget())
 	{
 		me->SetState(CREATURE_STATES::JUMPING);
 	}
@@ -320,4 +494,94 @@ void AI_GroundShockwaver::OnDistanceReached()
 void AI_GroundShockwaver::OnDistanceLost()
 {
 	activated = false;
-}
\ No newline at end of file
+}
+
+void AI_Chaser::SaveState(StateWriter &w)
+{
+	BaseAI::SaveState(w);
+	w.Write(chase);
+}
+
+void AI_Chaser::LoadState(StateReader &r)
+{
+	BaseAI::LoadState(r);
+	r.Read(chase);
+}
+
+void AI_ChaserJumper::SaveState(StateWriter &w)
+{
+	BaseAI::SaveState(w);
+	w.Write(chase);
+}
+
+void AI_ChaserJumper::LoadState(StateReader &r)
+{
+	BaseAI::LoadState(r);
+	r.Read(chase);
+}
+
+void AI_HomingMissile::SaveState(StateWriter &w)
+{
+	BaseAI::SaveState(w);
+	w.Write(homing);
+}
+
+void AI_HomingMissile::LoadState(StateReader &r)
+{
+	BaseAI::LoadState(r);
+	r.Read(homing);
+}
+
+void AI_Hypno::SaveState(StateWriter &w)
+{
+	BaseAI::SaveState(w);
+	w.Write(center);
+	w.Write(curDegree);
+}
+
+void AI_Hypno::LoadState(StateReader &r)
+{
+	BaseAI::LoadState(r);
+	r.Read(center);
+	r.Read(curDegree);
+}
+
+void AI_Sentinel::SaveState(StateWriter &w)
+{
+	BaseAI::SaveState(w);
+	w.Write(activated);
+}
+
+void AI_Sentinel::LoadState(StateReader &r)
+{
+	BaseAI::LoadState(r);
+	r.Read(activated);
+}
+
+void AI_Jumpingfire::SaveState(StateWriter &w)
+{
+	BaseAI::SaveState(w);
+	w.Write(activated);
+	w.Write(startingY);
+}
+
+void AI_Jumpingfire::LoadState(StateReader &r)
+{
+	BaseAI::LoadState(r);
+	r.Read(activated);
+	r.Read(startingY);
+}
+
+void AI_GroundShockwaver::SaveState(StateWriter &w)
+{
+	BaseAI::SaveState(w);
+	w.Write(activated);
+	w.Write(startingY);
+}
+
+void AI_GroundShockwaver::LoadState(StateReader &r)
+{
+	BaseAI::LoadState(r);
+	r.Read(activated);
+	r.Read(startingY);
+}
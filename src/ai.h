@@ -2,8 +2,10 @@
 #define _ai_h_ 
 
 #include <SDL.h>
+#include <string>
 #include <vector>
 #include "globals.h"
+#include "navigation.h"
 #include "utils.h"
 
 enum AI_TIMER_TYPE {
@@ -12,12 +14,28 @@ enum AI_TIMER_TYPE {
 };
 
 class Creature;
+class StateReader;
+class StateWriter;
+
+// Distances at which an AI notices and loses its target, squared where that
+// saves a square root
+struct AIRanges
+{
+	double reachSquared;
+	double reachX;
+	double reachY;
+	double lossSquared;
+};
 
 class BaseAI
 {
 	protected:
 		// internal generic vars
 		bool distanceReached = false;
+		// path to the target over the navigation graph
+		NavPath path;
+		int pathGoal = -1;
+		int navProfile = -1;
 
 	protected:
 		// Customizeable AI properties
@@ -36,21 +54,45 @@ class BaseAI
 		bool oneTimeToggle = false;
 
 	public:
-		void RunAI(double ticks);
+		// think scheduling, see AIScheduler
+		bool scheduled = false;
+		double pendingTicks = 0;
+		double untilThink = 0;
+
+	public:
+		virtual ~BaseAI() {};
+		void RunAI(double ticks, bool inReach, bool outOfReach);
+		AIRanges GetRanges();
+		Creature* GetTarget() { return target; };
+		double GetTimeUntilThink();
+		bool IsEngaged() { return distanceReached; };
+		// node numbers change with the navigation graph
+		void ForgetPath() { path.clear(); pathGoal = -1; };
 		void SetDistanceToReachX(int x) { distanceToReachX = x; distanceToReach = 1000; };
 		void SetDistanceToReachY(int y) { distanceToReachY = y; distanceToReach = 1000; };
 		virtual void OnStateChange(CREATURE_STATES oldState, CREATURE_STATES newState) {};
+		// name used for the AI in maps and save states
+		virtual const char* GetName() = 0;
+		virtual void SaveState(StateWriter &w);
+		virtual void LoadState(StateReader &r);
 
 	protected:
 		BaseAI(Creature *c);
 		virtual void Wander();
 		virtual void TurnToTarget();
+		int GetNavProfile();
+		bool FindNextStep(int from, NavStep &next);
+		bool FollowPathToTarget();
+		bool CanSeeTarget();
 		virtual void OnTimerTimeup(int id) {};
 		virtual void OnDistanceReached() {};
 		virtual void OnDistanceLost() {};
 		void Trigger(int id);
 }; 
 
+// Makes an AI by its name, nullptr if there's no such AI
+BaseAI* CreateAI(std::string name, Creature *c);
+
 class AI_Chaser: public BaseAI
 {
 	private:
@@ -65,6 +107,9 @@ class AI_Chaser: public BaseAI
 			timeToTrigger = std::vector<double> { wanderChangeDirTime };
 			timerTime = std::vector<double>{ 0 };
 		};
+		const char* GetName() { return "Chaser"; };
+		void SaveState(StateWriter &w);
+		void LoadState(StateReader &r);
 
 	private:
 		void OnDistanceReached();
@@ -91,6 +136,9 @@ class AI_ChaserJumper: public BaseAI
 			timerTime = std::vector<double>{ 0 };
 			followTargetInAir = false;
 		};
+		const char* GetName() { return "ChaserJumper"; };
+		void SaveState(StateWriter &w);
+		void LoadState(StateReader &r);
 
 	private:
 		void OnDistanceReached();
@@ -106,6 +154,7 @@ class AI_Wanderer: public BaseAI
 			timeToTrigger = std::vector<double>{ SecToTicks(1) };
 			timerTime = std::vector<double>{ 0 };
 		};
+		const char* GetName() { return "Wanderer"; };
 
 	private:
 		void OnTimerTimeup(int id);
@@ -118,6 +167,7 @@ class AI_Idle: public BaseAI
 		{
 			distanceToLoss = 30;
 		};
+		const char* GetName() { return "Idle"; };
 
 	private:
 		void OnDistanceReached();
@@ -134,6 +184,9 @@ class AI_HomingMissile: public BaseAI
 			timerTime = std::vector<double>{ 0 ,0};
 			followTargetInAir = true;
 		};
+		const char* GetName() { return "HomingMissile"; };
+		void SaveState(StateWriter &w);
+		void LoadState(StateReader &r);
 
 	private:
 		void OnDistanceReached();
@@ -150,6 +203,9 @@ class AI_Hypno: public BaseAI
 			timeToTrigger = std::vector<double>{ 0 };
 			timerTime = std::vector<double>{ 0 };
 		};
+		const char* GetName() { return "Hypno"; };
+		void SaveState(StateWriter &w);
+		void LoadState(StateReader &r);
 
 	private:
 		void OnTimerTimeup(int id);
@@ -161,6 +217,7 @@ class AI_Liner: public BaseAI
 		AI_Liner(Creature *c) : BaseAI(c) {
 			distanceToReach = 200;
 		};
+		const char* GetName() { return "Liner"; };
 
 	private:
 		void OnDistanceReached();
@@ -176,6 +233,9 @@ class AI_Sentinel: public BaseAI
 			timerTime = std::vector<double>{ 0 };
 			oneTimeToggle = true;
 		};
+		const char* GetName() { return "Sentinel"; };
+		void SaveState(StateWriter &w);
+		void LoadState(StateReader &r);
 
 	private:
 		void OnDistanceReached();
@@ -188,6 +248,7 @@ class AI_Anvil : public BaseAI
 		AI_Anvil(Creature *c) : BaseAI(c) {
 			distanceToReach = 1;
 		};
+		const char* GetName() { return "Anvil"; };
 
 	private:
 		void OnDistanceReached();
@@ -203,6 +264,9 @@ class AI_Jumpingfire : public BaseAI
 			timeToTrigger = std::vector<double>{ 0 };
 			timerTime = std::vector<double>{ 0 };
 		};
+		const char* GetName() { return "Jumpingfire"; };
+		void SaveState(StateWriter &w);
+		void LoadState(StateReader &r);
 
 	private:
 		void OnDistanceReached();
@@ -219,6 +283,9 @@ public:
 		timeToTrigger = std::vector<double>{ 0, SecToTicks(2) };
 		timerTime = std::vector<double>{ 0 , 0 };
 	};	
+	const char* GetName() { return "GroundShockwaver"; };
+	void SaveState(StateWriter &w);
+	void LoadState(StateReader &r);
 
 private:
 	void OnDistanceReached();
@@ -0,0 +1,157 @@
+#include "aischeduler.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "ai.h"
+#include "entities.h"
+#include "gamelogic.h"
+#include "profiler.h"
+#include "replay.h"
+#include "visibility.h"
+
+extern std::vector<Creature*> creatures;
+extern double const MAX_THINK_PERIOD;
+
+namespace AIScheduler
+{
+	// thinkers are spread over this many phases of their think period
+	int const STAGGER_SLOTS = 4;
+	int const DEFAULT_BUDGET = 1000; // us
+
+	// The player as it was when this update's thinking started
+	struct TargetSnapshot
+	{
+		Creature *creature = nullptr;
+		double x = 0;
+		double y = 0;
+	};
+
+	int budget = DEFAULT_BUDGET;
+	int nextSlot = 0;
+	std::vector<Creature*> due;
+	TargetSnapshot snapshot;
+
+	// distances of due thinkers to their targets, by index in due
+	std::vector<double> offsetsX;
+	std::vector<double> offsetsY;
+	std::vector<AIRanges> ranges;
+	std::vector<Uint8> reached;
+	std::vector<Uint8> lost;
+
+	void TakeSnapshot()
+	{
+		Player *player = Game::GetPlayer();
+		snapshot.creature = player;
+		if(!player)
+			return;
+		snapshot.x = player->GetX();
+		snapshot.y = player->GetY();
+	}
+
+	// Range checks of all due thinkers in one go, in squared distances
+	void CheckRanges()
+	{
+		int count = (int)due.size();
+		offsetsX.resize(count);
+		offsetsY.resize(count);
+		ranges.resize(count);
+		reached.resize(count);
+		lost.resize(count);
+		for(int i = 0; i < count; i++)
+		{
+			Creature *target = due[i]->AI->GetTarget();
+			// nearly everything targets the player
+			double targetX = target == snapshot.creature ? snapshot.x : target->GetX();
+			double targetY = target == snapshot.creature ? snapshot.y : target->GetY();
+			offsetsX[i] = due[i]->GetX() - targetX;
+			offsetsY[i] = due[i]->GetY() - targetY;
+			ranges[i] = due[i]->AI->GetRanges();
+		}
+		// no branches or calls, so the compiler can vectorize it
+		for(int i = 0; i < count; i++)
+		{
+			double dx = offsetsX[i];
+			double dy = offsetsY[i];
+			double distance = dx * dx + dy * dy;
+			reached[i] = (distance < ranges[i].reachSquared) & (fabs(dx) < ranges[i].reachX) & (fabs(dy) < ranges[i].reachY);
+			lost[i] = distance > ranges[i].lossSquared;
+		}
+	}
+
+	// these never get put off
+	bool IsUrgent(Creature *c)
+	{
+		return c->AI->IsEngaged() || Visibility::IsVisible(*c);
+	}
+
+	void Update(double ticks)
+	{
+		Uint64 start = Profiler::GetTime();
+		due.clear();
+		for(auto &c : creatures)
+		{
+			if(!c->AI || c->REMOVE_ME)
+				continue;
+			BaseAI *ai = c->AI;
+			if(!ai->scheduled)
+			{
+				// spreads the first distance checks, timers still run out on time
+				double slot = MAX_THINK_PERIOD * (nextSlot++ % STAGGER_SLOTS) / STAGGER_SLOTS;
+				ai->untilThink = std::min(ai->GetTimeUntilThink(), slot);
+				ai->scheduled = true;
+			}
+			ai->pendingTicks += ticks;
+			ai->untilThink -= ticks;
+			if(ai->untilThink <= 0)
+				due.push_back(c);
+		}
+		// replays have to make the same decisions however fast the machine is
+		bool budgeted = budget > 0 && !Replay::IsPlaying() && !Replay::IsRecording();
+		// urgent ones think first, so they're done before the budget runs out.
+		// Visibility depends on drawing, which seeking and fast-forward skip,
+		// so replays keep the creature order
+		if(budgeted)
+			std::stable_partition(due.begin(), due.end(), IsUrgent);
+		TakeSnapshot();
+		CheckRanges();
+		int deferred = 0;
+		for(int i = 0; i < (int)due.size(); i++)
+		{
+			Creature *c = due[i];
+			BaseAI *ai = c->AI;
+			if(budgeted && !IsUrgent(c) && Profiler::GetElapsedMs(start) * 1000 > budget)
+			{
+				// stays due and thinks over everything it missed next frame
+				deferred++;
+				continue;
+			}
+			ai->RunAI(ai->pendingTicks, !!reached[i], !!lost[i]);
+			ai->pendingTicks = 0;
+			ai->untilThink = ai->GetTimeUntilThink();
+		}
+
+		Profiler::AddSample(PROFILE_AI, Profiler::GetElapsedMs(start));
+		Profiler::AddSample(PROFILE_AI_DEFERRED, deferred);
+	}
+
+	void SetBudget(int microseconds)
+	{
+		budget = std::max(0, microseconds);
+	}
+
+	int GetBudget()
+	{
+		return budget;
+	}
+
+	// where the next new thinker gets staggered to, part of a save state
+	int GetStaggerSlot()
+	{
+		return nextSlot;
+	}
+
+	void SetStaggerSlot(int slot)
+	{
+		nextSlot = slot;
+	}
+}
@@ -0,0 +1,17 @@
+#ifndef _aischeduler_h_
+#define _aischeduler_h_
+
+// Decides which creatures think in a game update. Each AI thinks on the update
+// one of its timers runs out, and in between often enough to notice its target
+// coming into or leaving range. Creatures that are off screen and not engaged with
+// their target can be put off to the next frame once the time budget is spent.
+namespace AIScheduler
+{
+	void Update(double ticks);
+	void SetBudget(int microseconds);
+	int GetBudget();
+	int GetStaggerSlot();
+	void SetStaggerSlot(int slot);
+}
+
+#endif
@@ -2,99 +2,75 @@
 #include <SDL.h>
 #include "utils.h"
 
-Animation::Animation()
-{
-	CurrentFrame = 1;
-	Frames = 1;
-	FrameInc = 1;
-	FrameRate = 100; //Milliseconds
-	OldTime = SDL_GetTicks();
-	PixelInterval = 16;
-	OffsetX = 0;
-	OffsetY = 0;
-	loop = ANIM_LOOP_TYPES::LOOP_NONE;
-	loopFromFrame = 1;
-}
-
 Animation::Animation(int offset_x, int offset_y, int frames, int interval, int fps, ANIM_LOOP_TYPES loop, int loopFrom)
 {
-	CurrentFrame = 1;
-	FrameInc = 1;
-	OldTime = SDL_GetTicks();
-	OffsetX = offset_x;
-	OffsetY = offset_y;
-	Frames = frames;
-	PixelInterval = interval;
-	FrameRate = fps;
+	offsetX = offset_x;
+	offsetY = offset_y;
+	this->frames = frames;
+	pixelInterval = interval;
+	// zero would make the sprite step through frames forever in one update
+	frameTime = SDL_max(1, fps);
 	this->loop = loop;
 	loopFromFrame = loopFrom;
 }
 
-void Animation::Animate(int &x, int &y)
+void Animation::GetFrameCoords(int frame, int &x, int &y) const
 {
-	if(OldTime + FrameRate > SDL_GetTicks())
-	{
-		return;
-	}
-
-	//PrintLog(LOG_INFO, "current frame %i", CurrentFrame);
-	OldTime = SDL_GetTicks();
-	if(loop == ANIM_LOOP_TYPES::LOOP_PINGPONG)
-	{
-		if(FrameInc > 0)
-		{
-			if(CurrentFrame >= Frames)
-			{
-				FrameInc = -FrameInc;
-			}
-		}
-		else
-		{
-			if(CurrentFrame <= loopFromFrame)
-			{
-				FrameInc = -FrameInc;
-			}
-		}
-	}
-	else if(loop == ANIM_LOOP_TYPES::LOOP_NORMAL)
-	{
-		if(CurrentFrame > Frames)
-		{
-			CurrentFrame = loopFromFrame;
-		}
-	}
-	else if(loop == ANIM_LOOP_TYPES::LOOP_NONE)
-	{
-		if(CurrentFrame > Frames)
-		{
-			// Stop on the last frame
-			CurrentFrame--;
-		}
-	}
-	x = OffsetX + PixelInterval * (CurrentFrame - 1);
-	y = OffsetY;
-	CurrentFrame += FrameInc;
+	x = offsetX + pixelInterval * (frame - 1);
+	y = offsetY;
 }
 
-void Animation::SetFrameRate(int Rate)
+void Animation::ShiftOffset(int x, int y)
 {
-	FrameRate = Rate;
+	offsetX += x;
+	offsetY += y;
 }
 
-void Animation::SetCurrentFrame(int Frame)
+void AnimationState::Start(ANIMATION_TYPE type)
 {
-	if(Frame < 0 || Frame >= Frames) return;
-
-	CurrentFrame = Frame;
+	this->type = type;
+	playing = true;
+	frame = 1;
+	frameInc = 1;
+	time = 0;
 }
 
-int Animation::GetCurrentFrame()
+// Returns true if the shown frame changed
+bool AnimationState::Advance(const Animation &animation, double ms)
 {
-	return CurrentFrame;
-}
+	if(!playing || animation.frames <= 1)
+		return false;
 
-void Animation::ShowFrame(int Frame, int &x, int &y)
-{
-	x = OffsetX + PixelInterval * (Frame - 1);
-	y = OffsetY;
+	int oldFrame = frame;
+	time += ms;
+	while(time >= animation.frameTime)
+	{
+		time -= animation.frameTime;
+		if(animation.loop == ANIM_LOOP_TYPES::LOOP_PINGPONG)
+		{
+			if(frameInc > 0 && frame >= animation.frames)
+				frameInc = -frameInc;
+			else if(frameInc < 0 && frame <= animation.loopFromFrame)
+				frameInc = -frameInc;
+			frame += frameInc;
+		}
+		else if(animation.loop == ANIM_LOOP_TYPES::LOOP_NORMAL)
+		{
+			frame++;
+			if(frame > animation.frames)
+				frame = animation.loopFromFrame;
+		}
+		else if(animation.loop == ANIM_LOOP_TYPES::LOOP_NONE)
+		{
+			// Stop on the last frame
+			if(frame >= animation.frames)
+			{
+				playing = false;
+				time = 0;
+				break;
+			}
+			frame++;
+		}
+	}
+	return frame != oldFrame;
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define _animation_h_
 
 #include <SDL.h>
+#include <map>
 #include "globals.h"
 
 enum ANIMATION_TYPE
@@ -25,31 +26,36 @@ enum ANIMATION_TYPE
 	ANIMATION_IDLE
 };
 
-class Animation {
-	private:
-		int    CurrentFrame;
-		int     FrameInc;
-		int     FrameRate; //Milliseconds
-		int PixelInterval;
-		int OffsetX;
-		int OffsetY;
-		Uint32    OldTime;
-		int loopFromFrame;
-
-	public:
-		int    Frames;
-		ANIM_LOOP_TYPES   loop;
-
-	public:
-		Animation();
-		Animation(int offset_x, int offset_y, int frames, int interval, int fps, ANIM_LOOP_TYPES loop, int loopFrom);
-		void Animate(int &x, int &y);
-
-	public:
-		void SetFrameRate(int Rate);
-		void SetCurrentFrame(int Frame);
-		void ShowFrame(int Frame, int &x, int &y);
-		int GetCurrentFrame();
+// Frame layout of one animation, loaded once per entity type and shared by all its sprites
+struct Animation
+{
+	int offsetX = 0;
+	int offsetY = 0;
+	int frames = 1;
+	int pixelInterval = 16;
+	int frameTime = 100; // milliseconds
+	ANIM_LOOP_TYPES loop = LOOP_NONE;
+	int loopFromFrame = 1;
+
+	Animation() {};
+	Animation(int offset_x, int offset_y, int frames, int interval, int fps, ANIM_LOOP_TYPES loop, int loopFrom);
+	void GetFrameCoords(int frame, int &x, int &y) const;
+	void ShiftOffset(int x, int y);
+};
+
+typedef std::map<ANIMATION_TYPE, Animation> AnimationSet;
+
+// Playback state of a single sprite
+struct AnimationState
+{
+	ANIMATION_TYPE type = ANIMATION_NONE;
+	bool playing = false;
+	int frame = 1;
+	int frameInc = 1;
+	double time = 0; // milliseconds spent on the current frame
+
+	void Start(ANIMATION_TYPE type);
+	bool Advance(const Animation &animation, double ms);
 };
 
 #endif
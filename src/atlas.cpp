@@ -0,0 +1,151 @@
+#include "atlas.h"
+#include <SDL_image.h>
+#include <algorithm>
+#include "graphics.h"
+#include "utils.h"
+
+extern TextureManager textureManager;
+
+// empty pixels between packed images so neighbouring sprites never bleed into each other
+int const ATLAS_PADDING = 1;
+
+struct PackedImage
+{
+	std::string filename;
+	SDL_Surface *surface;
+};
+
+void TextureAtlas::AddImage(std::string filename)
+{
+	if(std::find(images.begin(), images.end(), filename) == images.end())
+		images.push_back(filename);
+}
+
+int TextureAtlas::Build(SDL_Renderer *renderer, int maxPageSize)
+{
+	std::vector<PackedImage> packed;
+	for(auto &i : images)
+	{
+		SDL_Surface *surface = IMG_Load(i.c_str());
+		if(!surface)
+		{
+			PrintLog(LOG_IMPORTANT, "Atlas: couldn't load %s: %s", i.c_str(), IMG_GetError());
+			continue;
+		}
+		if(surface->w + ATLAS_PADDING > maxPageSize || surface->h + ATLAS_PADDING > maxPageSize)
+		{
+			PrintLog(LOG_INFO, "Atlas: %s is too big to be packed, leaving it as a separate texture", i.c_str());
+			SDL_FreeSurface(surface);
+			continue;
+		}
+		packed.push_back({ i, surface });
+	}
+
+	// Shelf packing. Placing the tallest images first keeps the shelves tight
+	std::stable_sort(packed.begin(), packed.end(), [](const PackedImage &a, const PackedImage &b)
+	{
+		return a.surface->h > b.surface->h;
+	});
+
+	std::vector<SDL_Point> pageSizes;
+	int x = 0, y = 0, shelfHeight = 0;
+	for(auto &i : packed)
+	{
+		int w = i.surface->w;
+		int h = i.surface->h;
+		if(x + w > maxPageSize)
+		{
+			// start a new shelf
+			x = 0;
+			y += shelfHeight;
+			shelfHeight = 0;
+		}
+		if(pageSizes.empty() || y + h > maxPageSize)
+		{
+			// start a new page
+			pageSizes.push_back({ 0, 0 });
+			x = y = shelfHeight = 0;
+		}
+		AtlasRegion region;
+		region.page = (int)pageSizes.size() - 1;
+		region.rect = { x, y, w, h };
+		regions[i.filename] = region;
+
+		x += w + ATLAS_PADDING;
+		shelfHeight = std::max(shelfHeight, h + ATLAS_PADDING);
+		pageSizes.back().x = std::max(pageSizes.back().x, x);
+		pageSizes.back().y = std::max(pageSizes.back().y, y + shelfHeight);
+	}
+
+	for(int page = 0; page < (int)pageSizes.size(); page++)
+	{
+		SDL_Surface *pageSurface = SDL_CreateRGBSurfaceWithFormat(0, pageSizes[page].x, pageSizes[page].y, 32, SDL_PIXELFORMAT_RGBA32);
+		if(!pageSurface)
+		{
+			PrintLog(LOG_IMPORTANT, "Atlas: couldn't create page %i: %s", page, SDL_GetError());
+			// images of this page stay separate textures
+			for(auto i = regions.begin(); i != regions.end();)
+			{
+				if(i->second.page == page)
+					i = regions.erase(i);
+				else
+					++i;
+			}
+			pages.push_back(INVALID_TEXTURE_HANDLE);
+			continue;
+		}
+		for(auto &i : packed)
+		{
+			if(!Contains(i.filename) || regions[i.filename].page != page)
+				continue;
+			// copy pixels as they are, alpha included
+			SDL_SetSurfaceBlendMode(i.surface, SDL_BLENDMODE_NONE);
+			SDL_BlitSurface(i.surface, NULL, pageSurface, &regions[i.filename].rect);
+		}
+		SDL_Texture *tex = SDL_CreateTextureFromSurface(renderer, pageSurface);
+		SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+		SDL_FreeSurface(pageSurface);
+
+		std::string name = "atlas:" + std::to_string(page);
+		pages.push_back(textureManager.AddTexture(name, tex));
+		PrintLog(LOG_INFO, "Atlas: page %i is %ix%i", page, pageSizes[page].x, pageSizes[page].y);
+	}
+
+	for(auto &i : packed)
+		SDL_FreeSurface(i.surface);
+
+	PrintLog(LOG_INFO, "Atlas: packed %i images into %i pages", (int)regions.size(), (int)pages.size());
+	return (int)pages.size();
+}
+
+bool TextureAtlas::Contains(std::string filename)
+{
+	return regions.find(filename) != regions.end();
+}
+
+AtlasRegion TextureAtlas::GetRegion(std::string filename)
+{
+	return regions.at(filename);
+}
+
+TextureHandle TextureAtlas::GetPageTexture(int page)
+{
+	return pages.at(page);
+}
+
+int TextureAtlas::GetPageCount()
+{
+	return (int)pages.size();
+}
+
+void TextureAtlas::Clear()
+{
+	for(auto i : pages)
+	{
+		if(i != INVALID_TEXTURE_HANDLE)
+			textureManager.UnloadTexture(i);
+	}
+	images.clear();
+	regions.clear();
+	pages.clear();
+}
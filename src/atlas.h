@@ -0,0 +1,36 @@
+#ifndef _atlas_h_
+#define _atlas_h_
+
+#include <SDL.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "globals.h"
+
+// Where a packed image ended up: atlas page and its rectangle on that page
+struct AtlasRegion
+{
+	int page = 0;
+	SDL_Rect rect = { 0, 0, 0, 0 };
+};
+
+// Packs separate images into a few big textures so sprites drawn one after
+// another can share the same texture. Pages are owned by the texture manager.
+class TextureAtlas
+{
+	private:
+		std::vector<std::string> images;
+		std::map<std::string, AtlasRegion> regions;
+		std::vector<TextureHandle> pages;
+
+	public:
+		void AddImage(std::string filename);
+		int Build(SDL_Renderer *renderer, int maxPageSize);
+		bool Contains(std::string filename);
+		AtlasRegion GetRegion(std::string filename);
+		TextureHandle GetPageTexture(int page);
+		int GetPageCount();
+		void Clear();
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include "benchmark.h"
+#include <algorithm>
+#include <cstring>
+#include "framepacing.h"
+#include "gamelogic.h"
+#include "preloader.h"
+#include "profiler.h"
+#include "utils.h"
+
+namespace Benchmark
+{
+	int const DEFAULT_FRAMES = 1000;
+
+	bool enabled = false;
+	std::string mapName;
+	int framesToRun = DEFAULT_FRAMES;
+
+	int frames = 0;
+	// only frames that drew the game scene
+	int sceneFrames = 0;
+	Uint64 startTime = 0;
+	RenderStats total;
+	RenderStats peak;
+
+	bool ParseArgs(int argc, char* argv[])
+	{
+		for(int i = 1; i < argc; i++)
+		{
+			if(strcmp(argv[i], "-benchmark") != 0)
+				continue;
+			if(i + 1 >= argc)
+			{
+				PrintLog(LOG_IMPORTANT, "Benchmark: no map given");
+				return false;
+			}
+			mapName = argv[i + 1];
+			if(i + 2 < argc)
+				framesToRun = std::max(1, atoi(argv[i + 2]));
+			enabled = true;
+		}
+		return enabled;
+	}
+
+	bool IsEnabled()
+	{
+		return enabled;
+	}
+
+	void Start()
+	{
+		// uploads would end up in the measured frames otherwise
+		while(!Preloader::IsDone())
+		{
+			Preloader::Update();
+			SDL_Delay(1);
+		}
+
+		FramePacing::SetMode(FRAME_PACING_UNCAPPED);
+		Game::CreateLevel(mapName);
+		Game::ResetPlayerLives();
+		Game::Start();
+		Game::SetState(STATE_GAME);
+
+		Profiler::Reset();
+		startTime = Profiler::GetTime();
+		PrintLog(LOG_IMPORTANT, "Benchmark: running %s for %i frames", mapName.c_str(), framesToRun);
+	}
+
+	void EndFrame(RenderStats stats)
+	{
+		if(Game::GetState() == STATE_GAME)
+		{
+			sceneFrames++;
+			total.commands += stats.commands;
+			total.drawCalls += stats.drawCalls;
+			total.textureSwitches += stats.textureSwitches;
+			peak.commands = std::max(peak.commands, stats.commands);
+			peak.drawCalls = std::max(peak.drawCalls, stats.drawCalls);
+			peak.textureSwitches = std::max(peak.textureSwitches, stats.textureSwitches);
+		}
+		frames++;
+		if(frames >= framesToRun)
+			Game::SetGameEndFlag();
+	}
+
+	void Report()
+	{
+		double ms = Profiler::GetElapsedMs(startTime);
+		PrintLog(LOG_IMPORTANT, "Benchmark: %i frames in %.1f ms, %.3f ms/frame", frames, ms, frames ? ms / frames : 0);
+		if(sceneFrames)
+		{
+			PrintLog(LOG_IMPORTANT, "Benchmark: per frame %.1f commands (peak %i), %.1f draw calls (peak %i), %.1f texture switches (peak %i)",
+				total.commands / (double)sceneFrames, peak.commands,
+				total.drawCalls / (double)sceneFrames, peak.drawCalls,
+				total.textureSwitches / (double)sceneFrames, peak.textureSwitches);
+		}
+		// the profiler only keeps the latest frames
+		Profiler::Report();
+	}
+}
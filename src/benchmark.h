@@ -0,0 +1,20 @@
+#ifndef _benchmark_h_
+#define _benchmark_h_
+
+#include <SDL.h>
+#include <string>
+#include "renderqueue.h"
+
+// Renders a map offscreen for a fixed number of frames as fast as possible,
+// then reports frame times, draw calls and texture switches.
+// Started with: platformer -benchmark <map> [frames]
+namespace Benchmark
+{
+	bool ParseArgs(int argc, char* argv[]);
+	bool IsEnabled();
+	void Start();
+	void EndFrame(RenderStats stats);
+	void Report();
+}
+
+#endif
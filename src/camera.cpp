@@ -63,6 +63,14 @@ void Camera::SetRect(SDL_Rect &r)
 	y = r.y;
 }
 
+void Camera::SetPRect(PrecisionRect r)
+{
+	x = r.x;
+	y = r.y;
+	h = r.h;
+	w = r.w;
+}
+
 void Camera::Attach(Entity &p)
 {
 	at = &p;
@@ -218,4 +226,9 @@ bool Camera::IsAttachedTo(Entity *e)
 SDL_Rect Camera::GetVirtualCamRect()
 {
 	return virtualCam;
-}
\ No newline at end of file
+}
+
+void Camera::SetVirtualCamRect(SDL_Rect r)
+{
+	virtualCam = r;
+}
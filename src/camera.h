@@ -4,6 +4,10 @@
 #include <SDL.h>
 #include "entities.h"
 
+// size of the game's own view, whatever the resolution
+extern const int VIRTUAL_CAM_WIDTH;
+extern const int VIRTUAL_CAM_HEIGHT;
+
 class Camera
 {
 	private:
@@ -31,10 +35,12 @@ class Camera
 		SDL_Rect GetRect();
 		void SetRect(SDL_Rect &r);
 		PrecisionRect GetPRect();
+		void SetPRect(PrecisionRect r);
 		void SetOffsetX(int x);
 		void SetOffsetY(int y);
 		bool IsAttachedTo(Entity *e);
 		SDL_Rect GetVirtualCamRect();
+		void SetVirtualCamRect(SDL_Rect r);
 };
 
 #endif
@@ -5,6 +5,8 @@
 #include <fstream>
 #include <string>
 #include "INIReader.h"
+#include "aischeduler.h"
+#include "framepacing.h"
 #include "gamelogic.h"
 #include "globals.h"
 #include "graphics.h"
@@ -66,10 +68,19 @@ std::map<std::string, int> scalingModeNames = {
 	{ "Letterboxed", SCALING_LETTERBOXED }
 };
 
+std::map<std::string, int> framePacingModeNames = {
+	{ "VSync", FRAME_PACING_VSYNC },
+	{ "Adaptive", FRAME_PACING_ADAPTIVE },
+	{ "Capped", FRAME_PACING_CAPPED },
+	{ "Uncapped", FRAME_PACING_UNCAPPED }
+};
+
 void InitConfig()
 {
 	LoadDefaultBinds();
-	LoadConfig();
+	// headless runs have to look and play the same on any machine
+	if(!Graphics::IsHeadless())
+		LoadConfig();
 }
 
 void LoadDefaultBinds()
@@ -135,15 +146,20 @@ void LoadConfig()
 	mode.format = std::stoul(reader.Get("Video", "Format", "0").c_str());
 	Graphics::SetDisplayMode(mode);
 	Graphics::SetScalingMode(scalingModeNames[reader.Get("Video", "ScalingMode", "Default")]);
+	FramePacing::SetMode(framePacingModeNames[reader.Get("Video", "FramePacing", "VSync")]);
+	FramePacing::SetFpsCap(atoi(reader.Get("Video", "FpsCap", "60").c_str()));
 	Sound::SetMusicVolume(atoi(reader.Get("Sound", "Music", "100").c_str()));
 	Sound::SetSfxVolume(atoi(reader.Get("Sound", "Sfx", "100").c_str()));
 	Game::SetDebug(!!atoi(reader.Get("Other", "Debug", "0").c_str()));
+	AIScheduler::SetBudget(atoi(reader.Get("Other", "AIBudget", "1000").c_str()));
 }
 
 void SaveConfig()
 {
 	// This overwrites all previous content in the file with current bindings
 	// OK for now but if we want to add non-binding stuff later it becomes much more complicated to do
+	if(Graphics::IsHeadless())
+		return;
 	std::ofstream file("config.ini");
 	if(!file.good())
 	{
@@ -170,12 +186,15 @@ void SaveConfig()
 	file << "RefreshRate=" << displayMode.refresh_rate << std::endl;
 	file << "Format=" << displayMode.format << std::endl;
 	file << "ScalingMode=" << GetScalingModeName(Graphics::GetScalingMode()) << std::endl;
+	file << "FramePacing=" << GetFramePacingModeName(FramePacing::GetMode()) << std::endl;
+	file << "FpsCap=" << FramePacing::GetFpsCap() << std::endl;
 
 	file << "[Sound]" << std::endl;
 	file << "Music=" << Sound::GetMusicVolume() << std::endl;
 	file << "Sfx=" << Sound::GetSfxVolume() << std::endl;
 	file << "[Other]" << std::endl;
 	file << "Debug=" << Game::IsDebug() << std::endl;
+	file << "AIBudget=" << AIScheduler::GetBudget() << std::endl;
 }
 
 void SetKeyboardBind(SDL_Keycode code, KEYBINDS bind)
@@ -260,6 +279,23 @@ std::string GetScalingModeName(int mode)
 	}
 }
 
+std::string GetFramePacingModeName(int mode)
+{
+	switch(mode)
+	{
+		case FRAME_PACING_VSYNC:
+			return "VSync";
+		case FRAME_PACING_ADAPTIVE:
+			return "Adaptive";
+		case FRAME_PACING_CAPPED:
+			return "Capped";
+		case FRAME_PACING_UNCAPPED:
+			return "Uncapped";
+		default:
+			return "";
+	}
+}
+
 std::string GetKeyboardKeyName(SDL_Keycode code)
 {
 	const char* name = SDL_GetKeyName(code);
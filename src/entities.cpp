@@ -10,6 +10,7 @@
 #include "state.h"
 #include "tiles.h"
 #include "utils.h"
+#include "visibility.h"
 
 RandomGenerator entity_rg;
 
@@ -23,14 +24,6 @@ std::vector<Effect*> effects;
 int doorPairs = 0;
 extern TextureManager textureManager;
 
-struct PlatformData
-{
-	bool solid = false;
-	bool hookable = false;
-	bool standable = false;
-	std::string graphicsName;
-};
-
 std::map<std::string, CreatureData> creatureData;
 std::map<std::string, PlatformData> platformData;
 std::map<std::string, EntityGraphicsData> entityGraphicsData;
@@ -89,7 +82,6 @@ void ReadCreatureData()
 		EntityGraphicsData cr;
 
 		cr.textureFile = rea.Get("Sprite", "TextureName", "dummy.png");
-		cr.sprite.SetSpriteTexture(textureManager.GetTexture(cr.textureFile));
 
 		SDL_Rect rect;
 		rect.x = rea.GetInteger("Sprite", "X", 0);
@@ -145,7 +137,7 @@ void ReadCreatureData()
 					loopFrom = atoi(tokens[6].c_str());
 				else
 					loopFrom = 1;
-				cr.sprite.AddAnimation(i.second, animOffX, animOffY, animNumFrames, animInterval, animFps, (ANIM_LOOP_TYPES)animLoopType, loopFrom);
+				cr.animations[i.second] = Animation(animOffX, animOffY, animNumFrames, animInterval, animFps, (ANIM_LOOP_TYPES)animLoopType, loopFrom);
 			}
 		}
 		entityGraphicsData[fileName] = cr;
@@ -177,6 +169,17 @@ void ReadPlatformData()
 	fileList.clear();
 }
 
+// Done after the data is read, whether it came from the INI files or the cache
+void LoadEntityTextures()
+{
+	for(auto &i : entityGraphicsData)
+	{
+		i.second.sprite.SetSpriteTexture(textureManager.LoadTexture(i.second.textureFile));
+		// sprites created from this one share the stored tables instead of copying them
+		i.second.sprite.SetAnimationSet(&i.second.animations);
+	}
+}
+
 Player::Player()
 {
 	move_vel = 2;
@@ -565,6 +568,7 @@ Creature::Creature(std::string type)
 		delete this;
 		return;
 	}
+	this->type = type;
 	health = creatureData[type].health;
 	ignoreGravity = creatureData[type].ignoreGravity;
 	ignoreWorld = creatureData[type].ignoreWorld;
@@ -640,6 +644,18 @@ bool Creature::IsAI()
 	return !(this->AI == nullptr);
 }
 
+// by the name of the AI, see CreateAI
+bool Creature::SetAI(std::string name)
+{
+	BaseAI *ai = CreateAI(name, this);
+	if(ai == nullptr)
+		return false;
+	if(this->IsAI())
+		delete this->AI;
+	this->AI = ai;
+	return true;
+}
+
 void DynamicEntity::AttachTo(DynamicEntity *e)
 {
 	attached = e;
@@ -893,6 +909,7 @@ Pickup::Pickup(PICKUP_TYPES spawnType)
 {
 	pickups.push_back(this);
 	entityID = AssignEntityID(LIST_PICKUPS);
+	Visibility::InvalidatePickups();
 
 	type = spawnType;
 
@@ -973,6 +990,7 @@ DynamicEntity::~DynamicEntity()
 Pickup::~Pickup()
 {
 	pickups.erase(std::remove(pickups.begin(), pickups.end(), this), pickups.end());
+	Visibility::InvalidatePickups();
 	delete hitbox;
 	delete sprite;
 	hitbox = NULL;
@@ -992,6 +1010,7 @@ Effect::Effect(EFFECT_TYPES type)
 {
 	effects.push_back(this);
 	entityID = AssignEntityID(LIST_EFFECTS);
+	this->type = type;
 
 	switch(type)
 	{
@@ -1192,7 +1211,13 @@ void Creature::ProcessBulletHit(Bullet *b)
 
 	this->TakeDamage(b->damage);
 	if(this == Game::GetPlayer())
-		ApplyKnockback(*this, *(Creature*)b->owner);
+	{
+		// a bullet loaded after its shooter died has no owner, so it pushes by itself
+		if(b->owner != nullptr)
+			ApplyKnockback(*this, *(Creature*)b->owner);
+		else
+			ApplyKnockback(*this, static_cast<DIRECTIONS>(b->GetX() > GetX() ? 1 : -1));
+	}
 }
 
 void Creature::SetStun(double sec)
@@ -1498,16 +1523,25 @@ void Creature::TouchSpikes()
 	}
 }
 
-std::vector<SDL_Point> CalcLightningPoints(SDL_Point from, DIRECTIONS direction)
+// Number of different bolt shapes generated at startup
+int const LIGHTNING_LIBRARY_SIZE = 16;
+// Distance a bolt can travel: every pixel costs 2 in the air, 1 in the rain
+int const LIGHTNING_BUDGET = 150;
+
+std::vector<LightningBolt> lightningLibrary;
+
+// Generates a bolt going right as if it was all the way in the rain (the longest it can get).
+// Shots cut it off with GetLightningCutoff
+std::vector<LightningPoint> CalcLightningPoints()
 {
-	std::vector<SDL_Point> points;
+	std::vector<LightningPoint> points;
 	std::vector<LightningBranch> branches;
 
 	int maxBranches = 3;
 	int maxSpread = 9;
 	bool isAlive = true;
 
-	branches.push_back(LightningBranch{ 0, 0, 0, false, 20, 150 });
+	branches.push_back(LightningBranch{ 0, 0, 0, false, 20, LIGHTNING_BUDGET });
 	int i = 0;
 
 	while(isAlive)
@@ -1545,30 +1579,10 @@ std::vector<SDL_Point> CalcLightningPoints(SDL_Point from, DIRECTIONS direction)
 				l.offset = maxSpread * -1;
 
 			l.timeUntilBranchable--;
-			int taperOff = l.lifetime < 10 ? 512 : l.lifetime < 30 ? 256 : 0;
-			points.push_back(SDL_Point{ i, 10 + l.offset + taperOff });
-
-			SDL_Point curPos;
-			curPos = { from.x + i, from.y + l.offset };
-
-			switch(GetTileTypeAtPos(curPos))
-			{
-				case PHYSICS_BLOCK: case PHYSICS_ICE: case PHYSICS_ICEBLOCK: case PHYSICS_OB:
-				{
-					l.lifetime = 0;
-					break;
-				}
-				case PHYSICS_RAIN:
-				{
-					l.lifetime--;
-					break;
-				}
-				default:
-				{
-					l.lifetime -= 2;
-				}
-			}
+			int thickness = l.lifetime < 10 ? 1 : l.lifetime < 30 ? 2 : 3;
+			points.push_back(LightningPoint{ i, 10 + l.offset, thickness });
 
+			l.lifetime--;
 			if(l.lifetime > 0) isAlive = true;
 		}
 
@@ -1592,18 +1606,56 @@ std::vector<SDL_Point> CalcLightningPoints(SDL_Point from, DIRECTIONS direction)
 		if(branchFrom > -1)
 			branches.push_back(LightningBranch{ branches.at(branchFrom).offset,0,way,false,30,std::min(branches.at(0).lifetime + 10,30) });
 
-		if(!direction)
-			i--;
-		else
-			i++;
+		i++;
 	}
+	return points;
+}
 
-	if(!direction)
+void BuildLightningLibrary()
+{
+	lightningLibrary.clear();
+	for(int i = 0; i < LIGHTNING_LIBRARY_SIZE; i++)
 	{
-		for(auto &p : points)
-			p.x = 0 - p.x;
+		LightningBolt bolt;
+		bolt.points = CalcLightningPoints();
+		bolt.length = bolt.points.back().x + 1;
+		bolt.height = 3 + 20;
+		lightningLibrary.push_back(bolt);
 	}
-	return points;
+}
+
+// Walks along the bolt tile by tile and returns how far it gets before hitting
+// a wall or running out of budget
+int GetLightningCutoff(SDL_Point from, DIRECTIONS direction, int maxLength)
+{
+	int length = 0;
+	int budget = LIGHTNING_BUDGET;
+	while(length < maxLength && budget > 0)
+	{
+		int x = direction ? from.x + length : from.x - length;
+		if(x < 0)
+			break;
+
+		int cost;
+		switch(GetTileTypeAtPos(x, from.y))
+		{
+			case PHYSICS_BLOCK: case PHYSICS_ICE: case PHYSICS_ICEBLOCK: case PHYSICS_OB:
+				return length;
+			case PHYSICS_RAIN:
+				cost = 1;
+				break;
+			default:
+				cost = 2;
+		}
+
+		// pixels left until the next tile
+		int step = direction ? TILESIZE - x % TILESIZE : x % TILESIZE + 1;
+		step = std::min(step, maxLength - length);
+		step = std::min(step, (budget + cost - 1) / cost);
+		length += step;
+		budget -= step * cost;
+	}
+	return std::min(length, maxLength);
 }
 
 Lightning::Lightning(DynamicEntity &shooter)
@@ -1623,13 +1675,15 @@ Lightning::Lightning(DynamicEntity &shooter)
 	if(!direction)
 		posFrom = { (int)shooter.GetX(), (int)shooter.GetY() - 20 };
 
-	std::vector<SDL_Point> points = CalcLightningPoints(posFrom, shooter.direction);
-	tex = Graphics::GenerateLightningTexture(points);
+	origin = posFrom;
+	bolt = &lightningLibrary.at(entity_rg.Generate(0, lightningLibrary.size() - 1));
+	length = GetLightningCutoff(posFrom, shooter.direction, bolt->length);
 
-	int width, height;
-	SDL_QueryTexture(tex, NULL, NULL, &width, &height);
+	int width = length;
+	int height = bolt->height;
 	hitbox->SetSize(width, height);
-	sprite = new Sprite(&tex, 0, 0, height, width);
+	// no texture, only used for placement. Bolts are drawn by Graphics::RenderLightnings
+	sprite = new Sprite(INVALID_TEXTURE_HANDLE, 0, 0, height, width);
 	sprite->SetSpriteOffset(0, -height + 3);
 
 	// placing hitbox where it should be
@@ -1656,8 +1710,6 @@ void Lightning::Remove()
 
 Lightning::~Lightning()
 {
-	if(this->tex != nullptr)
-		SDL_DestroyTexture(this->tex);
 	lightnings.erase(std::remove(lightnings.begin(), lightnings.end(), this), lightnings.end());
 }
 
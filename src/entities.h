@@ -144,6 +144,21 @@ class Bullet : public DynamicEntity
 		void Remove();
 };
 
+struct LightningPoint
+{
+	int x;
+	int y; // center of the bolt column
+	int thickness; // 1-3, thinner towards the end of a branch
+};
+
+// Pre-generated bolt shape going right, reused by every shot
+struct LightningBolt
+{
+	std::vector<LightningPoint> points; // sorted by x
+	int length; // in pixels, before clipping
+	int height;
+};
+
 class Lightning : public DynamicEntity
 {
 	public:
@@ -151,7 +166,9 @@ class Lightning : public DynamicEntity
 		Velocity vel;
 		double lifetime; // Time in ticks
 		bool piercing;
-		SDL_Texture *tex;
+		const LightningBolt *bolt; // shared with the bolt library
+		int length; // visible part of the bolt
+		SDL_Point origin; // where the bolt comes out
 
 	public:
 		~Lightning();
@@ -172,6 +189,7 @@ struct LightningBranch
 class Creature : public DynamicEntity
 {
 	public:
+		std::string type; // creature data it was made from, empty for the player
 		int health;
 		double jumptime;
 		double jump_accel;
@@ -225,6 +243,7 @@ class Creature : public DynamicEntity
 				delete this->AI;
 			this->AI = new T((Creature*)this);
 		};
+		bool SetAI(std::string name);
 		void SetState(CREATURE_STATES state);
 		void SetState(CreatureState *newState);
 		void HandleInput(int input, int type);
@@ -247,6 +266,14 @@ struct CreatureData
 	std::string graphicsName;
 };
 
+struct PlatformData
+{
+	bool solid = false;
+	bool hookable = false;
+	bool standable = false;
+	std::string graphicsName;
+};
+
 struct EntityGraphicsData
 {
 	std::string textureFile;
@@ -255,10 +282,13 @@ struct EntityGraphicsData
 	// spriteRect, offsets
 	// and animations
 	// offsetX, offsetY, frames, interval, fps, loopType
+	AnimationSet animations;
 };
 
 void ReadCreatureData();
 void ReadPlatformData();
+void LoadEntityTextures();
+void BuildLightningLibrary();
 
 class Player : public Creature
 {
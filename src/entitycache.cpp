@@ -0,0 +1,262 @@
+#include "entitycache.h"
+#include <SDL.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "entities.h"
+#include "gamelogic.h"
+#include "profiler.h"
+#include "savestate.h"
+#include "utils.h"
+
+extern std::map<std::string, CreatureData> creatureData;
+extern std::map<std::string, PlatformData> platformData;
+extern std::map<std::string, EntityGraphicsData> entityGraphicsData;
+
+namespace EntityCache
+{
+	Uint32 const MAGIC = 0x43544E45; // "ENTC"
+	// bump whenever what's written changes
+	Uint16 const VERSION = 1;
+	// magic, version, source hash, size and checksum of everything after the header
+	int const HEADER_SIZE = 18;
+	std::string const CACHE_FILE = "assets/data/entities.cache";
+	std::vector<std::string> const SOURCE_FOLDERS = {
+		"assets/data/creatures",
+		"assets/data/graphics",
+		"assets/data/platforms"
+	};
+
+	bool ParseArgs(int argc, char* argv[])
+	{
+		for(int i = 1; i < argc; i++)
+		{
+			if(strcmp(argv[i], "-buildcache") == 0)
+				return true;
+		}
+		return false;
+	}
+
+	// Names and contents of every INI file the cache is built from
+	Uint32 HashSources()
+	{
+		std::vector<char> sources;
+		for(auto &folder : SOURCE_FOLDERS)
+		{
+			std::vector<std::string> fileList;
+			GetFolderFileList(folder, fileList);
+			// directory order depends on the file system
+			std::sort(fileList.begin(), fileList.end());
+			for(auto &i : fileList)
+			{
+				std::string name = folder + "/" + i;
+				std::vector<char> data;
+				ReadFileData(name, data);
+				sources.insert(sources.end(), name.c_str(), name.c_str() + name.size() + 1);
+				sources.insert(sources.end(), data.begin(), data.end());
+			}
+		}
+		return HashData(sources.data(), sources.size());
+	}
+
+	void WriteCreature(StateWriter &w, CreatureData &c)
+	{
+		w.Write(c.blinkDamaged);
+		w.Write(c.ignoreWorld);
+		w.Write(c.ignoreGravity);
+		w.Write(c.gravityMultiplier);
+		w.Write(c.health);
+		w.Write(c.term_vel);
+		w.Write(c.move_vel);
+		w.Write(c.weapon);
+		w.WriteString(c.graphicsName);
+	}
+
+	void ReadCreature(StateReader &r, CreatureData &c)
+	{
+		r.Read(c.blinkDamaged);
+		r.Read(c.ignoreWorld);
+		r.Read(c.ignoreGravity);
+		r.Read(c.gravityMultiplier);
+		r.Read(c.health);
+		r.Read(c.term_vel);
+		r.Read(c.move_vel);
+		r.Read(c.weapon);
+		c.graphicsName = r.ReadString();
+	}
+
+	void WritePlatform(StateWriter &w, PlatformData &p)
+	{
+		w.Write(p.solid);
+		w.Write(p.hookable);
+		w.Write(p.standable);
+		w.WriteString(p.graphicsName);
+	}
+
+	void ReadPlatform(StateReader &r, PlatformData &p)
+	{
+		r.Read(p.solid);
+		r.Read(p.hookable);
+		r.Read(p.standable);
+		p.graphicsName = r.ReadString();
+	}
+
+	// Textures aren't part of the cache, only the name of their file
+	void WriteGraphics(StateWriter &w, EntityGraphicsData &g)
+	{
+		w.WriteString(g.textureFile);
+		w.Write(g.hitbox.GetRect());
+		w.Write(g.sprite.GetTextureCoords());
+		w.Write(g.sprite.GetSpriteOffsetX());
+		w.Write(g.sprite.GetSpriteOffsetY());
+		w.Write((Uint32)g.animations.size());
+		for(auto &i : g.animations)
+		{
+			w.Write(i.first);
+			w.Write(i.second);
+		}
+	}
+
+	void ReadGraphics(StateReader &r, EntityGraphicsData &g)
+	{
+		g.textureFile = r.ReadString();
+		g.hitbox.SetRect(r.Read<SDL_Rect>());
+		g.sprite.SetSpriteRect(r.Read<SDL_Rect>());
+		int offX = r.Read<int>();
+		int offY = r.Read<int>();
+		g.sprite.SetSpriteOffset(offX, offY);
+		Uint32 count = r.Read<Uint32>();
+		for(Uint32 i = 0; i < count && !r.Failed(); i++)
+		{
+			ANIMATION_TYPE type = r.Read<ANIMATION_TYPE>();
+			g.animations[type] = r.Read<Animation>();
+		}
+	}
+
+	template<typename T>
+	void WriteMap(StateWriter &w, std::map<std::string, T> &map, void(*writeValue)(StateWriter&, T&))
+	{
+		w.Write((Uint32)map.size());
+		for(auto &i : map)
+		{
+			w.WriteString(i.first);
+			writeValue(w, i.second);
+		}
+	}
+
+	template<typename T>
+	void ReadMap(StateReader &r, std::map<std::string, T> &map, void(*readValue)(StateReader&, T&))
+	{
+		Uint32 count = r.Read<Uint32>();
+		for(Uint32 i = 0; i < count && !r.Failed(); i++)
+		{
+			std::string name = r.ReadString();
+			readValue(r, map[name]);
+		}
+	}
+
+	// Parses the INI files and writes the cache from what they had
+	bool Build()
+	{
+		creatureData.clear();
+		platformData.clear();
+		entityGraphicsData.clear();
+		ReadCreatureData();
+		ReadPlatformData();
+		return Save();
+	}
+
+	bool Load()
+	{
+		std::vector<char> data;
+		if(!ReadFileData(CACHE_FILE, data))
+			return false;
+
+		StateReader header(data);
+		Uint32 magic = header.Read<Uint32>();
+		Uint16 version = header.Read<Uint16>();
+		Uint32 sourceHash = header.Read<Uint32>();
+		Uint32 size = header.Read<Uint32>();
+		Uint32 checksum = header.Read<Uint32>();
+		if(header.Failed() || magic != MAGIC || version != VERSION)
+		{
+			PrintLog(LOG_INFO, "%s is from another version", CACHE_FILE.c_str());
+			return false;
+		}
+		if(size != data.size() - HEADER_SIZE || checksum != HashData(&data[HEADER_SIZE], size))
+		{
+			PrintLog(LOG_IMPORTANT, "%s is corrupted", CACHE_FILE.c_str());
+			return false;
+		}
+		// hashing means reading every INI file, so only done where they get edited
+		if(Game::IsDebug() && sourceHash != HashSources())
+		{
+			PrintLog(LOG_INFO, "Entity data changed since %s was built", CACHE_FILE.c_str());
+			return false;
+		}
+
+		StateReader r(data, HEADER_SIZE);
+		std::map<std::string, CreatureData> creatures;
+		std::map<std::string, PlatformData> platforms;
+		std::map<std::string, EntityGraphicsData> graphics;
+		ReadMap(r, creatures, ReadCreature);
+		ReadMap(r, platforms, ReadPlatform);
+		ReadMap(r, graphics, ReadGraphics);
+		if(r.Failed())
+		{
+			PrintLog(LOG_IMPORTANT, "%s is corrupted", CACHE_FILE.c_str());
+			return false;
+		}
+		creatureData.swap(creatures);
+		platformData.swap(platforms);
+		entityGraphicsData.swap(graphics);
+		return true;
+	}
+
+	bool Save()
+	{
+		std::vector<char> data;
+		StateWriter w(data);
+		w.Write(MAGIC);
+		w.Write(VERSION);
+		w.Write(HashSources());
+		// size and checksum, filled in at the end
+		w.Write((Uint32)0);
+		w.Write((Uint32)0);
+
+		WriteMap(w, creatureData, WriteCreature);
+		WriteMap(w, platformData, WritePlatform);
+		WriteMap(w, entityGraphicsData, WriteGraphics);
+
+		Uint32 size = (Uint32)data.size() - HEADER_SIZE;
+		Uint32 checksum = HashData(&data[HEADER_SIZE], size);
+		memcpy(&data[10], &size, sizeof(size));
+		memcpy(&data[14], &checksum, sizeof(checksum));
+
+		SDL_RWops *rw = SDL_RWFromFile(CACHE_FILE.c_str(), "wb");
+		if(!rw)
+		{
+			PrintLog(LOG_IMPORTANT, "Can't write %s", CACHE_FILE.c_str());
+			return false;
+		}
+		bool written = SDL_RWwrite(rw, data.data(), 1, data.size()) == data.size();
+		SDL_RWclose(rw);
+		PrintLog(LOG_INFO, "Built %s: %i creatures, %i platforms, %i graphics", CACHE_FILE.c_str(),
+			(int)creatureData.size(), (int)platformData.size(), (int)entityGraphicsData.size());
+		return written;
+	}
+
+	// Fills the entity data from the cache, or from the INI files when the
+	// cache can't be used, and loads the textures it needs
+	void Init()
+	{
+		Uint64 start = Profiler::GetTime();
+		bool cached = Load();
+		if(!cached)
+			Build();
+		PrintLog(LOG_INFO, "Read entity data from %s in %.3f ms", cached ? "the cache" : "INI files", Profiler::GetElapsedMs(start));
+		LoadEntityTextures();
+	}
+}
@@ -0,0 +1,19 @@
+#ifndef _entitycache_h_
+#define _entitycache_h_
+
+// Creature, platform and entity graphics data compiled from the INI files in
+// assets/data into one binary file, so startup reads a single file instead
+// of parsing a few hundred. The cache keeps a hash of the INI files it was
+// built from. It's rebuilt when it's missing or broken, and in debug mode
+// also when the INI files changed. Build it on its own with:
+// platformer -buildcache
+namespace EntityCache
+{
+	bool ParseArgs(int argc, char* argv[]);
+	bool Build();
+	bool Load();
+	bool Save();
+	void Init();
+}
+
+#endif
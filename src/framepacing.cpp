@@ -0,0 +1,135 @@
+#include "framepacing.h"
+#include <algorithm>
+#include "graphics.h"
+#include "profiler.h"
+#include "utils.h"
+
+namespace FramePacing
+{
+	// Longest step the game logic is allowed to take after a stall, in ticks
+	double const MAX_TICKS_PER_FRAME = 4;
+	// Sleeping is only precise to a couple of ms, the rest of the wait is spun
+	double const SPIN_TIME = 2;
+
+	FRAME_PACING_MODES mode = FRAME_PACING_VSYNC;
+	int fpsCap = 60;
+
+	// what the renderer was actually created with
+	bool rendererCreated = false;
+	bool rendererVsync = false;
+	bool hardwareAdaptive = false;
+
+	Uint64 frameStart = 0;
+	Uint64 nextFrame = 0;
+	double frameTime = 0; // ms
+	bool clockReset = false;
+
+	void Init(SDL_Renderer *renderer)
+	{
+		SDL_RendererInfo info;
+		SDL_GetRendererInfo(renderer, &info);
+		rendererCreated = true;
+		rendererVsync = (info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+
+		// Late swap tearing is only available through OpenGL, other renderers get a software cap
+		if(mode == FRAME_PACING_ADAPTIVE)
+			hardwareAdaptive = SDL_GL_SetSwapInterval(-1) == 0;
+
+		frameStart = nextFrame = Profiler::GetTime();
+		PrintLog(LOG_INFO, "Renderer %s, vsync %i, adaptive vsync %i", info.name, rendererVsync, hardwareAdaptive);
+	}
+
+	void SetMode(int mode)
+	{
+		FramePacing::mode = (FRAME_PACING_MODES)mode;
+		if(rendererCreated && rendererVsync != IsVsyncRequested())
+			PrintLog(LOG_INFO, "Vsync change will be applied after restart");
+	}
+
+	FRAME_PACING_MODES GetMode()
+	{
+		return mode;
+	}
+
+	void SetFpsCap(int fps)
+	{
+		fpsCap = fps;
+	}
+
+	int GetFpsCap()
+	{
+		return fpsCap;
+	}
+
+	// Whether the renderer should be created with vsync
+	bool IsVsyncRequested()
+	{
+		return mode == FRAME_PACING_VSYNC;
+	}
+
+	// Frame rate to hold with sleeping, 0 if the display or nothing limits it
+	int GetTargetFps()
+	{
+		switch(mode)
+		{
+			case FRAME_PACING_VSYNC:
+				// mode was switched from the menu, vsync comes back after restart
+				return rendererVsync ? 0 : Graphics::GetRefreshRate();
+			case FRAME_PACING_ADAPTIVE:
+				return hardwareAdaptive ? 0 : Graphics::GetRefreshRate();
+			case FRAME_PACING_CAPPED:
+				return fpsCap > 0 ? fpsCap : Graphics::GetRefreshRate();
+			default:
+				return 0;
+		}
+	}
+
+	void BeginFrame()
+	{
+		Uint64 now = Profiler::GetTime();
+		frameTime = (now - frameStart) * 1000.0 / SDL_GetPerformanceFrequency();
+		frameStart = now;
+		// only the time since waking up, not a frame
+		if(clockReset)
+			clockReset = false;
+		else
+			Profiler::AddSample(PROFILE_FRAME, frameTime);
+	}
+
+	void EndFrame()
+	{
+		int targetFps = GetTargetFps();
+		if(targetFps <= 0)
+			return;
+
+		Uint64 frequency = SDL_GetPerformanceFrequency();
+		Uint64 period = frequency / targetFps;
+		Uint64 now = Profiler::GetTime();
+		nextFrame += period;
+		// fell behind, don't try to catch up with a burst of short frames
+		if(nextFrame < now)
+			nextFrame = now;
+
+		double remaining = (nextFrame - now) * 1000.0 / frequency;
+		if(remaining > SPIN_TIME)
+			SDL_Delay((Uint32)(remaining - SPIN_TIME));
+		while(Profiler::GetTime() < nextFrame)
+			;
+	}
+
+	// Starts timing again after the loop slept waiting for events, so the
+	// sleep neither shows up as a long frame nor moves the game on
+	void ResetClock()
+	{
+		frameStart = nextFrame = Profiler::GetTime();
+		clockReset = true;
+	}
+
+	// How many game ticks (1/60 of a second) the last frame took
+	double GetTicksMultiplier()
+	{
+		if(mode == FRAME_PACING_VSYNC && rendererVsync)
+			return 1. / (Graphics::GetRefreshRate() / 60.);
+		return std::min(MAX_TICKS_PER_FRAME, frameTime * 60. / 1000.);
+	}
+}
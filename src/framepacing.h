@@ -0,0 +1,21 @@
+#ifndef _framepacing_h_
+#define _framepacing_h_
+
+#include <SDL.h>
+#include "globals.h"
+
+namespace FramePacing
+{
+	void Init(SDL_Renderer *renderer);
+	void SetMode(int mode);
+	FRAME_PACING_MODES GetMode();
+	void SetFpsCap(int fps);
+	int GetFpsCap();
+	bool IsVsyncRequested();
+	void BeginFrame();
+	void EndFrame();
+	void ResetClock();
+	double GetTicksMultiplier();
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "gamelogic.h"
+#include "aischeduler.h"
 #include <SDL.h>
 #include <fstream>
 #include <vector>
@@ -6,10 +7,14 @@
 #include "graphics.h"
 #include "interface.h"
 #include "level.h"
+#include "lineofsight.h"
 #include "levelspecific.h"
 #include "menu.h"
+#include "navigation.h"
 #include "physics.h"
+#include "replay.h"
 #include "sound.h"
+#include "streaming.h"
 #include "transition.h"
 #include "utils.h"
 
@@ -58,11 +63,13 @@ namespace Game
 
 	void CreateLevel(std::string fileName)
 	{
+		Replay::OnLevelStart();
 		level = new Level(fileName);
 	}
 
 	void RemoveLevel()
 	{
+		Replay::OnLevelEnd();
 		if(level != nullptr)
 			delete level;
 		level = nullptr;
@@ -93,6 +100,7 @@ namespace Game
 			Sound::PauseMusic();
 		}
 		GameState = state;
+		Graphics::RequestRedraw();
 	}
 
 	void ChangeState(GAMESTATES state)
@@ -175,6 +183,8 @@ namespace Game
 			GameOver(GAME_OVER_REASON_DIED);
 			return;
 		}
+		Navigation::BeginFrame();
+		LineOfSight::BeginFrame();
 
 		//gameTimer.Run();
 		//if(gameTimer.completed)
@@ -195,12 +205,14 @@ namespace Game
 
 		player->HandleStateIdle();
 		ApplyPhysics(*player, ticks);
+		Navigation::SetFlowTarget(*player);
 		//// Updating camera
 		//if(player->hasState(STATE_LOOKINGUP))
 		//	camera->SetOffsetY(-20);
 		//if(player->hasState(STATE_DUCKING))
 		//	camera->SetOffsetY(35);
 		Graphics::GetCamera()->Update();
+		Streaming::Update(Graphics::GetCamera()->GetVirtualCamRect(), Graphics::GetVisibleRect());
 
 		for(auto &b : bullets)
 		{
@@ -221,6 +233,7 @@ namespace Game
 		}
 		CleanFromNullPointers(&creatures); // they can be dead already
 
+		AIScheduler::Update(ticks);
 		for(auto &i : creatures)
 		{
 			if(player->hitbox->HasCollision(i->hitbox))
@@ -228,8 +241,6 @@ namespace Game
 				OnHitboxCollision(*player, *i, ticks);
 				PrintLog(LOG_SUPERDEBUG, "what %d", SDL_GetTicks());
 			}
-			if(i->AI)
-				i->AI->RunAI(ticks);
 			ApplyPhysics(*i, ticks);
 			UpdateStatus(*i, ticks);
 			if(i->REMOVE_ME)
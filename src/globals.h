@@ -137,6 +137,10 @@ enum PICKUP_TYPES
 	PICKUP_GRENADE
 };
 
+// Index of a texture in the texture manager, resolved once at load time
+typedef int TextureHandle;
+TextureHandle const INVALID_TEXTURE_HANDLE = -1;
+
 struct TileFrame
 {
 	int id;
@@ -146,8 +150,7 @@ struct TileFrame
 struct TileAnimationData
 {
 	std::vector<TileFrame> sequence;
-	unsigned __int32 timer;
-	int currentFrame;
+	int currentFrame = 0;
 };
 
 struct CustomTile
@@ -155,8 +158,6 @@ struct CustomTile
 	int type;
 	int x_offset;
 	int y_offset;
-	int animated_x_offset;
-	int animated_y_offset;
 	TileAnimationData animationData;
 };
 
@@ -189,6 +190,7 @@ enum MENUS
 	MENU_SELECTION_DISPLAY_MODE,
 	MENU_SELECTION_FULLSCREEN,
 	MENU_SELECTION_SCALING_MODE,
+	MENU_SELECTION_FRAME_PACING,
 	MENU_PLAYER_FAILED,
 	MENU_PLAYER_FAILED_NO_ESCAPE,
 	MENU_MAPSELECT,
@@ -264,4 +266,12 @@ enum SCALING_MODES
 	SCALING_LETTERBOXED
 };
 
+enum FRAME_PACING_MODES
+{
+	FRAME_PACING_VSYNC,
+	FRAME_PACING_ADAPTIVE,
+	FRAME_PACING_CAPPED,
+	FRAME_PACING_UNCAPPED
+};
+
 #endif
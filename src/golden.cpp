@@ -0,0 +1,237 @@
+#include "golden.h"
+#include <SDL_image.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "framepacing.h"
+#include "gamelogic.h"
+#include "preloader.h"
+#include "profiler.h"
+#include "replay.h"
+#include "utils.h"
+
+namespace GoldenFrames
+{
+	// per channel difference that still counts as the same pixel,
+	// scaling filters may round differently between renderers
+	int const DEFAULT_TOLERANCE = 8;
+	// loop frames without the replay moving on before giving up
+	int const STALL_FRAMES = 600;
+
+	bool enabled = false;
+	std::string replayFile;
+	std::string directory;
+	std::vector<int> captureFrames;
+	int tolerance = DEFAULT_TOLERANCE;
+
+	int nextCapture = 0;
+	int lastReplayFrame = -1;
+	int stalledFrames = 0;
+	int frames = 0;
+	int passed = 0;
+	int failed = 0;
+	int written = 0;
+	Uint64 startTime = 0;
+	// spent reading back and comparing, left out of the frame times
+	double captureMs = 0;
+
+	bool ParseArgs(int argc, char* argv[])
+	{
+		for(int i = 1; i < argc; i++)
+		{
+			if(strcmp(argv[i], "-golden") != 0)
+				continue;
+			if(i + 3 >= argc)
+			{
+				PrintLog(LOG_IMPORTANT, "Golden frames: usage is -golden <replay> <dir> <frame,frame,...> [tolerance]");
+				return false;
+			}
+			replayFile = argv[i + 1];
+			directory = argv[i + 2];
+			std::vector<std::string> tokens;
+			tokenize(argv[i + 3], tokens, ",", true);
+			for(auto &t : tokens)
+				captureFrames.push_back(atoi(t.c_str()));
+			std::sort(captureFrames.begin(), captureFrames.end());
+			if(i + 4 < argc)
+				tolerance = std::max(0, atoi(argv[i + 4]));
+			enabled = !captureFrames.empty();
+		}
+		return enabled;
+	}
+
+	bool IsEnabled()
+	{
+		return enabled;
+	}
+
+	bool Start()
+	{
+		if(!Replay::StartPlayback(replayFile))
+			return false;
+
+		// uploads would end up in the measured frames otherwise
+		while(!Preloader::IsDone())
+		{
+			Preloader::Update();
+			SDL_Delay(1);
+		}
+
+		FramePacing::SetMode(FRAME_PACING_UNCAPPED);
+		Game::CreateLevel(Replay::GetMapName());
+		Game::ResetPlayerLives();
+		Game::Start();
+		Game::SetState(STATE_GAME);
+
+		Profiler::Reset();
+		startTime = Profiler::GetTime();
+		PrintLog(LOG_IMPORTANT, "Golden frames: checking %i frames of %s", (int)captureFrames.size(), replayFile.c_str());
+		return true;
+	}
+
+	SDL_Surface* ReadFrame(SDL_Renderer *renderer)
+	{
+		int w, h;
+		if(SDL_GetRendererOutputSize(renderer, &w, &h) < 0)
+			return NULL;
+		SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGBA32);
+		if(!surface)
+			return NULL;
+		if(SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_RGBA32, surface->pixels, surface->pitch) < 0)
+		{
+			SDL_FreeSurface(surface);
+			return NULL;
+		}
+		return surface;
+	}
+
+	// Returns how many pixels differ by more than the tolerance
+	int CountDifferences(SDL_Surface *a, SDL_Surface *b)
+	{
+		if(a->w != b->w || a->h != b->h)
+			return a->w * a->h;
+		int differences = 0;
+		for(int y = 0; y < a->h; y++)
+		{
+			Uint8 *rowA = (Uint8*)a->pixels + y * a->pitch;
+			Uint8 *rowB = (Uint8*)b->pixels + y * b->pitch;
+			for(int x = 0; x < a->w * 4; x += 4)
+			{
+				for(int c = 0; c < 4; c++)
+				{
+					if(abs(rowA[x + c] - rowB[x + c]) > tolerance)
+					{
+						differences++;
+						break;
+					}
+				}
+			}
+		}
+		return differences;
+	}
+
+	void Capture(SDL_Renderer *renderer, int frame)
+	{
+		std::string file = directory + "/frame_" + std::to_string(frame) + ".png";
+		SDL_Surface *actual = ReadFrame(renderer);
+		if(!actual)
+		{
+			PrintLog(LOG_IMPORTANT, "Golden frames: couldn't read frame %i: %s", frame, SDL_GetError());
+			failed++;
+			return;
+		}
+
+		SDL_Surface *loaded = IMG_Load(file.c_str());
+		if(!loaded)
+		{
+			if(IMG_SavePNG(actual, file.c_str()) < 0)
+			{
+				PrintLog(LOG_IMPORTANT, "Golden frames: couldn't write %s: %s", file.c_str(), IMG_GetError());
+				failed++;
+			}
+			else
+			{
+				PrintLog(LOG_IMPORTANT, "Golden frames: wrote %s", file.c_str());
+				written++;
+			}
+			SDL_FreeSurface(actual);
+			return;
+		}
+
+		SDL_Surface *golden = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+		SDL_FreeSurface(loaded);
+		int differences = golden ? CountDifferences(actual, golden) : actual->w * actual->h;
+		if(differences == 0)
+			passed++;
+		else
+		{
+			failed++;
+			std::string actualFile = directory + "/frame_" + std::to_string(frame) + "_actual.png";
+			IMG_SavePNG(actual, actualFile.c_str());
+			PrintLog(LOG_IMPORTANT, "Golden frames: frame %i has %i different pixels, see %s", frame, differences, actualFile.c_str());
+		}
+		if(golden)
+			SDL_FreeSurface(golden);
+		SDL_FreeSurface(actual);
+	}
+
+	// Called after a frame is drawn, before it's presented
+	void OnFrameRendered(SDL_Renderer *renderer)
+	{
+		if(!enabled)
+			return;
+		frames++;
+
+		int frame = Replay::GetFrame();
+		if(frame == lastReplayFrame)
+		{
+			if(++stalledFrames >= STALL_FRAMES)
+			{
+				PrintLog(LOG_IMPORTANT, "Golden frames: replay stopped at frame %i", frame);
+				Game::SetGameEndFlag();
+			}
+			return;
+		}
+		lastReplayFrame = frame;
+		stalledFrames = 0;
+
+		Uint64 captureStart = Profiler::GetTime();
+		// replay frames count from 1, the first one played
+		while(nextCapture < (int)captureFrames.size() && captureFrames[nextCapture] <= frame)
+		{
+			if(captureFrames[nextCapture] == frame)
+				Capture(renderer, frame);
+			else
+			{
+				PrintLog(LOG_IMPORTANT, "Golden frames: frame %i was never drawn", captureFrames[nextCapture]);
+				failed++;
+			}
+			nextCapture++;
+		}
+		captureMs += Profiler::GetElapsedMs(captureStart);
+
+		if(nextCapture >= (int)captureFrames.size() || Replay::IsFinished())
+			Game::SetGameEndFlag();
+	}
+
+	void Report()
+	{
+		// frames asked for past the end of the replay
+		for(; nextCapture < (int)captureFrames.size(); nextCapture++)
+		{
+			PrintLog(LOG_IMPORTANT, "Golden frames: frame %i was never drawn", captureFrames[nextCapture]);
+			failed++;
+		}
+		double ms = Profiler::GetElapsedMs(startTime) - captureMs;
+		PrintLog(LOG_IMPORTANT, "Golden frames: %i frames in %.1f ms, %.3f ms/frame", frames, ms, frames ? ms / frames : 0);
+		PrintLog(LOG_IMPORTANT, "Golden frames: %i passed, %i failed, %i written", passed, failed, written);
+		Profiler::Report();
+	}
+
+	int GetFailures()
+	{
+		return failed;
+	}
+}
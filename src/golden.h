@@ -0,0 +1,20 @@
+#ifndef _golden_h_
+#define _golden_h_
+
+#include <SDL.h>
+
+// Plays a recorded replay offscreen and compares the frames rendered at the
+// given replay frames against golden images, so render changes can be checked
+// for visual differences. Missing golden images get written instead.
+// Started with: platformer -golden <replay> <dir> <frame,frame,...> [tolerance]
+namespace GoldenFrames
+{
+	bool ParseArgs(int argc, char* argv[]);
+	bool IsEnabled();
+	bool Start();
+	void OnFrameRendered(SDL_Renderer *renderer);
+	void Report();
+	int GetFailures();
+}
+
+#endif
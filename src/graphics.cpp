@@ -3,62 +3,128 @@
 #include <iomanip>
 #include <sstream>
 #include "animation.h"
+#include "atlas.h"
 #include "camera.h"
 #include "entities.h"
+#include "framepacing.h"
 #include "gamelogic.h"
 #include "interface.h"
 #include "level.h"
 #include "state.h"
 #include "tiles.h"
 #include "menu.h"
+#include "preloader.h"
+#include "profiler.h"
+#include "renderqueue.h"
 #include "transition.h"
 #include "utils.h"
+#include "visibility.h"
 
 TextureManager textureManager;
 
-bool TextureManager::IsLoaded(std::string filename)
+bool TextureManager::IsLoaded(const std::string &filename)
 {
-	return textures.find(filename) != textures.end();
+	return handles.find(filename) != handles.end();
 }
 
-void TextureManager::LoadTexture(std::string filename)
+TextureHandle TextureManager::GetHandle(const std::string &filename)
 {
-	if(IsLoaded(filename))
+	auto i = handles.find(filename);
+	if(i == handles.end())
+		return INVALID_TEXTURE_HANDLE;
+	return i->second;
+}
+
+TextureHandle TextureManager::Register(const std::string &name, SDL_Texture *tex)
+{
+	TextureHandle handle;
+	if(!freeHandles.empty())
 	{
-		PrintLog(LOG_DEBUG, "Texture %s is already loaded", filename);
-		return;
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+		textures[handle] = tex;
+		names[handle] = name;
+	}
+	else
+	{
+		handle = (TextureHandle)textures.size();
+		textures.push_back(tex);
+		names.push_back(name);
 	}
+	if(!name.empty())
+		handles[name] = handle;
+	return handle;
+}
+
+// Returns the handle of an already loaded texture or loads it
+TextureHandle TextureManager::LoadTexture(const std::string &filename)
+{
+	TextureHandle handle = GetHandle(filename);
+	if(handle != INVALID_TEXTURE_HANDLE)
+		return handle;
+
+	PrintLog(LOG_DEBUG, "Loading %s ", filename.c_str());
 	SDL_Texture *tex = IMG_LoadTexture(Graphics::GetRenderer(), filename.c_str());
-	textures[filename] = tex;
+	if(!tex)
+		PrintLog(LOG_IMPORTANT, "Couldn't load texture %s: %s", filename.c_str(), IMG_GetError());
+	return Register(filename, tex);
 }
 
-void TextureManager::UnloadTexture(std::string filename)
+// Replaces the texture if the name is taken, keeping its handle
+TextureHandle TextureManager::AddTexture(const std::string &name, SDL_Texture *tex)
 {
-	if(!IsLoaded(filename))
+	TextureHandle handle = GetHandle(name);
+	if(handle == INVALID_TEXTURE_HANDLE)
+		return Register(name, tex);
+
+	PrintLog(LOG_DEBUG, "Texture %s is replaced", name.c_str());
+	if(textures[handle])
+		SDL_DestroyTexture(textures[handle]);
+	textures[handle] = tex;
+	return handle;
+}
+
+// Nameless texture, can only be accessed with the returned handle
+TextureHandle TextureManager::AddTexture(SDL_Texture *tex)
+{
+	return Register(std::string(), tex);
+}
+
+void TextureManager::UnloadTexture(const std::string &filename)
+{
+	TextureHandle handle = GetHandle(filename);
+	if(handle == INVALID_TEXTURE_HANDLE)
 	{
 		PrintLog(LOG_DEBUG, "Texture %s is not loaded", filename.c_str());
 		return;
 	}
-	SDL_DestroyTexture(textures[filename]);
-	textures.erase(textures.find(filename));
+	UnloadTexture(handle);
 }
 
-SDL_Texture** TextureManager::GetTexture(std::string filename)
+void TextureManager::UnloadTexture(TextureHandle handle)
 {
-	if(!IsLoaded(filename))
-	{
-		PrintLog(LOG_DEBUG, "Texture %s is not loaded", filename.c_str());
-		PrintLog(LOG_DEBUG, "Loading %s ", filename.c_str());
-		LoadTexture(filename);
-	}
-	return &textures[filename];
+	if(handle < 0 || handle >= (int)textures.size())
+		return;
+	if(textures[handle])
+		SDL_DestroyTexture(textures[handle]);
+	textures[handle] = NULL;
+	if(!names[handle].empty())
+		handles.erase(names[handle]);
+	names[handle].clear();
+	freeHandles.push_back(handle);
 }
 
 void TextureManager::Clear()
 {
 	for(auto i : textures)
-		SDL_DestroyTexture(i.second);
+	{
+		if(i)
+			SDL_DestroyTexture(i);
+	}
 	textures.clear();
+	names.clear();
+	handles.clear();
+	freeHandles.clear();
 }
 
 // TODO: reorganize this
@@ -73,6 +139,7 @@ extern std::vector<Machinery*> machinery;
 extern std::vector<Lightning*> lightnings;
 extern std::vector<TileLayerData> tileLayers;
 extern std::vector<CustomTile> tileset;
+extern std::vector<SDL_Point> tileFrames;
 
 SDL_Color debug_color = { 50, 180, 0 };
 SDL_Color pause_color = { 255, 255, 255 };
@@ -94,6 +161,9 @@ namespace Graphics
 	std::vector<Timer*> TimersGraphics{ &timer100, &timerRain };
 	
 	int const MAX_TILES_VERTICALLY = 15;
+	// window size of headless runs, an integer scale of the game scene
+	int const HEADLESS_WIDTH = 640;
+	int const HEADLESS_HEIGHT = 480;
 
 	// Calculated based on resolution and scaling type
 	double RENDER_SCALE = 1;
@@ -105,10 +175,18 @@ namespace Graphics
 	SDL_Renderer *renderer = NULL;
 	SDL_Surface *player_surface = NULL;
 	SDL_Texture *level_texture = NULL;
-	SDL_Surface *lightningSegment = NULL;
-
-	SDL_Texture *unscaled_scene = nullptr;
+	// colors of the bolt column from top to bottom
+	SDL_Color lightningColors[3] = { { 255, 255, 255, 255 }, { 255, 255, 255, 255 }, { 255, 255, 255, 255 } };
+	std::vector<SDL_Rect> lightningRects[3];
+
+	// integer scale the game scene is drawn at
+	int sceneScale = 1;
+	// only used with a fractional render scale: the scene is drawn here at the next
+	// integer scale, then filtered down to the window in one linear pass
 	SDL_Texture *scaled_scene = nullptr;
+	// letterbox bars only change when the virtual camera moves relative to the view
+	SDL_Rect letterboxRects[4];
+	SDL_Point letterboxOffset = { -1, -1 };
 
 	SDL_Window *win = NULL;
 
@@ -128,8 +206,29 @@ namespace Graphics
 
 	Camera* camera;
 
+	TextureHandle titleTexture = INVALID_TEXTURE_HANDLE;
+	TextureHandle logoTexture = INVALID_TEXTURE_HANDLE;
+
+	// static screens (menus, transitions) are only redrawn when something marks them dirty
+	bool redrawRequested = true;
+
+	TextureAtlas spriteAtlas;
+	int const ATLAS_MAX_PAGE_SIZE = 2048;
+
+	// tiles and entities of the game scene, drawn in one sorted pass
+	RenderQueue renderQueue;
+
+	// software rendering into an offscreen window, for benchmarks on machines without a GPU
+	bool headless = false;
+
+	// Milliseconds of game scene drawn so far. Advanced by the game tick instead of the
+	// wall clock, so a replayed level looks the same frame by frame
+	double sceneTime = 0;
+
 	int FindDisplayModes();
 	void DrawVirtualCamera();
+	void BeginScene();
+	void EndScene();
 
 	Camera* GetCamera()
 	{
@@ -154,11 +253,8 @@ namespace Graphics
 		if(!player_surface)
 			player_surface = IMG_Load(textureName.c_str());
 
-		// Replace texture in the manager texture array
-		SDL_Texture **ptr = textureManager.GetTexture(textureName.c_str());
-		if(*ptr)
-			SDL_DestroyTexture(*ptr);
-		*ptr = SDL_CreateTextureFromSurface(renderer, player_surface);
+		// Replace texture in the manager, sprites keep the same handle
+		textureManager.AddTexture(textureName, SDL_CreateTextureFromSurface(renderer, player_surface));
 	}
 
 	void ChangePlayerColor(PLAYER_BODY_PARTS bodyPart, SDL_Color color)
@@ -167,6 +263,74 @@ namespace Graphics
 		InitPlayerTexture();
 	}
 
+	void RequestRedraw()
+	{
+		redrawRequested = true;
+	}
+
+	bool IsRedrawRequested()
+	{
+		return redrawRequested;
+	}
+
+	void BuildSpriteAtlas()
+	{
+		// player sheet gets recolored at runtime so it has to stay on its own
+		std::string playerTexture = entityGraphicsData[creatureData["Player"].graphicsName].textureFile;
+		for(auto &i : entityGraphicsData)
+		{
+			if(i.second.textureFile != playerTexture)
+				spriteAtlas.AddImage(i.second.textureFile);
+		}
+		for(auto &i : *GetInterfaces())
+		{
+			if(i.second.tex != INVALID_TEXTURE_HANDLE)
+				spriteAtlas.AddImage(i.second.textureFile);
+		}
+
+		SDL_RendererInfo info;
+		SDL_GetRendererInfo(renderer, &info);
+		int pageSize = ATLAS_MAX_PAGE_SIZE;
+		if(info.max_texture_width > 0)
+			pageSize = std::min(pageSize, info.max_texture_width);
+		if(info.max_texture_height > 0)
+			pageSize = std::min(pageSize, info.max_texture_height);
+
+		if(spriteAtlas.Build(renderer, pageSize) <= 0)
+			return;
+
+		std::vector<std::string> packedTextures;
+		for(auto &i : entityGraphicsData)
+		{
+			if(!spriteAtlas.Contains(i.second.textureFile))
+				continue;
+			AtlasRegion region = spriteAtlas.GetRegion(i.second.textureFile);
+			i.second.sprite.SetSpriteTexture(spriteAtlas.GetPageTexture(region.page));
+			i.second.sprite.ShiftTextureCoords(region.rect.x, region.rect.y);
+			for(auto &anim : i.second.animations)
+				anim.second.ShiftOffset(region.rect.x, region.rect.y);
+			packedTextures.push_back(i.second.textureFile);
+		}
+		for(auto &i : *GetInterfaces())
+		{
+			if(i.second.tex == INVALID_TEXTURE_HANDLE || !spriteAtlas.Contains(i.second.textureFile))
+				continue;
+			AtlasRegion region = spriteAtlas.GetRegion(i.second.textureFile);
+			i.second.tex = spriteAtlas.GetPageTexture(region.page);
+			i.second.origin = { region.rect.x, region.rect.y };
+			i.second.frame.x += region.rect.x;
+			i.second.frame.y += region.rect.y;
+			packedTextures.push_back(i.second.textureFile);
+		}
+
+		// separate copies aren't referenced by anything anymore
+		for(auto &i : packedTextures)
+		{
+			if(textureManager.IsLoaded(i))
+				textureManager.UnloadTexture(i);
+		}
+	}
+
 	int Init()
 	{
 		if(graphicsLoaded) return 0;
@@ -183,8 +347,14 @@ namespace Graphics
 
 		// create the window and renderer
 		// note that the renderer is accelerated
-		win = SDL_CreateWindow("Platformer", 100, 100, 640, 480, NULL);
-		renderer = SDL_CreateRenderer(win, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+		win = SDL_CreateWindow("Platformer", 100, 100, 640, 480, headless ? SDL_WINDOW_HIDDEN : 0);
+		Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+		if(headless)
+			rendererFlags = SDL_RENDERER_SOFTWARE;
+		else if(FramePacing::IsVsyncRequested())
+			rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+		renderer = SDL_CreateRenderer(win, -1, rendererFlags);
+		FramePacing::Init(renderer);
 
 		SDL_Surface *icon = IMG_Load("assets/misc/icon.png");
 		SDL_SetWindowIcon(win, icon);
@@ -199,7 +369,23 @@ namespace Graphics
 
 		InterfaceSetup();
 
-		lightningSegment = IMG_Load("assets/textures/millhilightning.png");
+		// Resolved once so the screens below don't look them up by name every frame
+		titleTexture = textureManager.LoadTexture("assets/textures/title.png");
+		logoTexture = textureManager.LoadTexture("assets/textures/logo.png");
+
+		// lightning is drawn with plain rectangles, only the colors are taken from the image
+		SDL_Surface *lightningSegment = IMG_Load("assets/textures/millhilightning.png");
+		if(lightningSegment)
+		{
+			SDL_Surface *pixels = SDL_ConvertSurfaceFormat(lightningSegment, SDL_PIXELFORMAT_RGBA32, 0);
+			for(int i = 0; pixels && i < 3 && i < pixels->h; i++)
+			{
+				Uint32 pixel = *(Uint32*)((Uint8*)pixels->pixels + i * pixels->pitch);
+				SDL_GetRGBA(pixel, pixels->format, &lightningColors[i].r, &lightningColors[i].g, &lightningColors[i].b, &lightningColors[i].a);
+			}
+			SDL_FreeSurface(pixels);
+			SDL_FreeSurface(lightningSegment);
+		}
 
 		graphicsLoaded = true;
 		return 1;
@@ -264,20 +450,39 @@ namespace Graphics
 		GAME_SCENE_WIDTH = static_cast<int>(ceil((double)WINDOW_WIDTH / RENDER_SCALE));
 		GAME_SCENE_HEIGHT = static_cast<int>(ceil((double)WINDOW_HEIGHT / RENDER_SCALE));
 
-		if(unscaled_scene)
-			SDL_DestroyTexture(unscaled_scene);
 		if(scaled_scene)
 		{
 			SDL_DestroyTexture(scaled_scene);
 			scaled_scene = nullptr;
 		}
-		unscaled_scene = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, GAME_SCENE_WIDTH, GAME_SCENE_HEIGHT);
+		sceneScale = std::max(1, static_cast<int>(ceil(RENDER_SCALE)));
+		letterboxOffset = { -1, -1 };
+		// integer scale is drawn straight to the window
+		if(floor(RENDER_SCALE) != RENDER_SCALE)
+		{
+			SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
+			scaled_scene = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, GAME_SCENE_WIDTH * sceneScale, GAME_SCENE_HEIGHT * sceneScale);
+			SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+		}
+		PrintLog(LOG_INFO, "Game scene is %ix%i drawn at %ix%s", GAME_SCENE_WIDTH, GAME_SCENE_HEIGHT, sceneScale, scaled_scene ? ", filtered down to the window" : "");
 
 		return 0;
 	}
 
 	void UpdateDisplayMode()
 	{
+		// golden frames and benchmarks don't depend on the local display or config
+		if(headless)
+		{
+			fullscreenMode = 0;
+			scalingMode = SCALING_ADAPTIVE;
+			SDL_DisplayMode mode = { SDL_PIXELFORMAT_RGB888, HEADLESS_WIDTH, HEADLESS_HEIGHT, 60, nullptr };
+			SetDisplayMode(mode);
+			MenusCleanup();
+			LoadMenus();
+			return;
+		}
+
 		SDL_WindowFlags flag;
 		switch(fullscreenMode)
 		{
@@ -312,13 +517,10 @@ namespace Graphics
 			PrintLog(LOG_IMPORTANT, "Display %i doesn't exist. Defaulting to 0", displayIndex);
 			displayIndex = 0;
 		}
-		SDL_DisplayMode mode;
-		if(displayMode.format == 0) // config is missing
-		{
-			mode = displayModes[0][0]; // first available
-		}
-		else
+		SDL_DisplayMode mode = displayModes[0][0]; // first available
+		if(displayMode.format != 0) // config isn't missing
 		{
+			bool found = false;
 			for(auto i : displayModes[displayIndex])
 			{
 				if(i.h == displayMode.h &&
@@ -327,9 +529,12 @@ namespace Graphics
 					i.format == displayMode.format)
 				{
 					mode = i;
+					found = true;
 					break;
 				}
 			}
+			if(!found)
+				PrintLog(LOG_IMPORTANT, "Display mode %ix%i isn't available. Defaulting to %ix%i", displayMode.w, displayMode.h, mode.w, mode.h);
 		}
 		SetDisplayMode(mode);
 		SDL_SetWindowDisplayMode(win, &mode);
@@ -338,10 +543,15 @@ namespace Graphics
 		LoadMenus();
 	}
 
-	void DrawFPS(long long dt)
+	void DrawFPS(double frameTime)
 	{
-		long long fps = 1000000000 / dt;
+		int fps = frameTime > 0 ? (int)(1000 / frameTime) : 0;
 		RenderText(10, 10, "fps: " + std::to_string(fps), debug_font, debug_color);
+
+		ProfilerStat frame = Profiler::GetStat(PROFILE_FRAME);
+		std::ostringstream o;
+		o << std::fixed << std::setprecision(2) << "frame: " << frame.average << "ms jitter: " << frame.jitter << "ms";
+		RenderText(10, 20, o.str(), debug_font, debug_color);
 	}
 
 	void BlitObserveTileAt(Tile* tile, int x, int y)
@@ -350,8 +560,8 @@ namespace Graphics
 		SDL_Rect rect;
 		SDL_Rect rect2;
 
-		rect.x = tile->tex_x;
-		rect.y = tile->tex_y;
+		rect.x = tileFrames[tile->id].x;
+		rect.y = tileFrames[tile->id].y;
 		rect.w = TILESIZE; rect.h = TILESIZE;
 
 		rect2.x = x + screenShake.offsetX;
@@ -360,7 +570,7 @@ namespace Graphics
 		rect2.h = rect.h;
 
 		//PrintLog(LOG_SUPERDEBUG, ("x= %d y= %d ", rect2.x, rect2.y);
-		SDL_RenderCopy(renderer, tile->src_tex, &rect, &rect2);
+		renderQueue.AddCopy(RENDER_LAYER_TILES, tile->src_tex, rect, rect2);
 	}
 
 	void BlitObservableTiles()
@@ -382,135 +592,160 @@ namespace Graphics
 			h = ConvertToTileCoord(virtCam.h, false);
 		}
 
-		int a = SDL_GetTicks();
-		// counters for current tile pos to blit to
-		for(int layerIndex = 0; layerIndex < (int)tileLayers.size(); layerIndex++)
+		for(auto &layer : tileLayers)
 		{
-			TileLayerData *curLayer = &tileLayers[layerIndex];
-			double parallaxDepthX = curLayer->parallaxDepthX;
-			int parallaxOffsetX = curLayer->parallaxOffsetX;
-
-			int actualX = (int)floor(parallaxDepthX * prect.x - parallaxOffsetX);
+			// Everything depending on the camera is worked out once per layer.
+			// Screen position of the layer's top left corner
+			int originX = (int)floor(layer.parallaxOffsetX - prect.x * layer.parallaxDepthX);
+			int originY = (int)floor(layer.parallaxOffsetY - prect.y * layer.parallaxDepthY);
+
+			// first tile seen on screen
+			int actualX = (int)floor(layer.parallaxDepthX * prect.x - layer.parallaxOffsetX);
+			int actualY = (int)floor(layer.parallaxDepthY * prect.y - layer.parallaxOffsetY);
 			if(scalingMode == SCALING_LETTERBOXED)
-				actualX += virtCam.x - prect.x;
+			{
+				actualX = (int)(actualX + virtCam.x - prect.x);
+				actualY = (int)(actualY + virtCam.y - prect.y);
+			}
 			actualX /= TILESIZE;
+			actualY /= TILESIZE;
+
+			// clamped to the layer so the loops below need no bounds checks
+			int firstX = std::max(0, actualX);
+			int lastX = std::min(layer.width - 1, actualX + w);
+			int firstY = std::max(0, actualY);
+			int lastY = std::min(layer.height - 1, actualY + h);
+			if(firstX > lastX || firstY > lastY)
+				continue;
 
-			for(int i = actualX; i <= actualX + w; i++)
+			int p = originX + firstX * TILESIZE;
+			for(int i = firstX; i <= lastX; i++, p += TILESIZE)
 			{
-				double parallaxDepthY = curLayer->parallaxDepthY;
-				int parallaxOffsetY = curLayer->parallaxOffsetY;
-				int actualY = (int)floor(parallaxDepthY * prect.y - parallaxOffsetY);
-				if(scalingMode == SCALING_LETTERBOXED)
-					actualY += virtCam.y - prect.y;
-				actualY /= TILESIZE;
-				int p = (int)floor(i * TILESIZE - prect.x * parallaxDepthX + parallaxOffsetX);
-				for(int j = actualY; j <= actualY + h; j++)
+				// layers are stored column by column
+				Tile **column = &layer.At(i, firstY);
+				int q = originY + firstY * TILESIZE;
+				for(int j = firstY; j <= lastY; j++, q += TILESIZE, column++)
 				{
-					if(i >= 0 && j >= 0 && i < level->width_in_tiles && j < level->height_in_tiles)
-					{
-						int q = (int)floor(j * TILESIZE - prect.y * parallaxDepthY + parallaxOffsetY);
-						Tile *tile = curLayer->tiles[i][j];
-						if(tile != nullptr)
-						{
-							tile->Animate();
-							BlitObserveTileAt(tile, p, q);
-						}
-					}
+					if(*column != nullptr)
+						BlitObserveTileAt(*column, p, q);
 				}
 			}
 		}
-		int b = SDL_GetTicks();
-		//PrintLog(LOG_DEBUG, "%d time passed", b - a);
 	}
 
 	void Update(double ticks)
 	{
+		sceneTime += ticks * 1000 / SecToTicks(1);
 		for(auto &t : TimersGraphics)
 		{
-			t->Run();
+			t->Run(GetSceneTime());
 		}
 		
-		SDL_SetRenderTarget(renderer, unscaled_scene);
+		Uint64 sceneStart = Profiler::GetTime();
+		BeginScene();
 
-		UpdateTileAnimations();
+		UpdateTileAnimations(GetSceneTime());
 
 		ScreenShakeUpdate(ticks);
+		Uint64 tilesStart = Profiler::GetTime();
 		BlitObservableTiles();
+		Profiler::AddSample(PROFILE_TILES, Profiler::GetElapsedMs(tilesStart));
 
-		// Renders everything in entities collections
-		for(auto &dy : machinery)
-			Render(*dy);
-		for(auto &p : pickups)
-		{
+		// off-screen entities are neither animated nor drawn
+		Visibility::Update(GetVisibleRect());
+		VisibleEntities &visible = Visibility::GetVisible();
+
+		Player *player = Game::GetPlayer();
+		for(auto &p : visible.pickups)
 			UpdateAnimation(*p);
-			Render(*p);
-		}
-		for(auto &d : creatures)
-		{
+		for(auto &d : visible.creatures)
 			UpdateAnimation(*d);
-			Render(*d);
-		}
-		for(auto &l : lightnings)
-		{
-			//UpdateAnimation(*l);
-			Render(*l);
-		}
-		Player *player = Game::GetPlayer();
 		UpdateAnimation(*player, ticks);
-		Render(*player);
-
-		for(auto &e : effects)
-		{
+		for(auto &e : visible.effects)
 			UpdateAnimation(*e);
-			Render(*e);
-		}
-
-		for(auto &b : bullets)
-		{
+		for(auto &b : visible.bullets)
 			UpdateAnimation(*b);
-			Render(*b);
-		}		
+		AnimateSprites(ticks);
+
+		// Queues everything in entities collections
+		for(auto &dy : visible.machinery)
+			Render(*dy, RENDER_LAYER_MACHINERY);
+		for(auto &p : visible.pickups)
+			Render(*p, RENDER_LAYER_PICKUPS);
+		for(auto &d : visible.creatures)
+			Render(*d, RENDER_LAYER_CREATURES);
+		RenderLightnings();
+		Render(*player, RENDER_LAYER_PLAYER);
+
+		for(auto &e : visible.effects)
+			Render(*e, RENDER_LAYER_EFFECTS);
+
+		for(auto &b : visible.bullets)
+			Render(*b, RENDER_LAYER_BULLETS);
+
+		// tiles and entities get drawn here, the rest of the frame is drawn right away
+		Uint64 drawStart = Profiler::GetTime();
+		renderQueue.Execute(renderer);
+		Profiler::AddSample(PROFILE_DRAW, Profiler::GetElapsedMs(drawStart));
 
 		RenderInterface();
 
+		Uint64 presentStart = Profiler::GetTime();
 		if(scalingMode == SCALING_LETTERBOXED)
 			DrawLetterbox();
 
 		if(Game::IsDebug()) DrawVirtualCamera();
 
-		// don't use upscaling+linear downscaling for integer render scale and default scaling mode
-		if(scalingMode == SCALING_DEFAULT && (floor(RENDER_SCALE) != RENDER_SCALE))
-		{
-			if(!scaled_scene)
-			{
-				SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
-				scaled_scene = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, GAME_SCENE_WIDTH * 4, GAME_SCENE_HEIGHT * 4);
-				SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
-			}
-			SDL_SetRenderTarget(renderer, scaled_scene);
-			SDL_RenderCopy(renderer, unscaled_scene, NULL, NULL);
+		EndScene();
+		Profiler::AddSample((PROFILER_STATS)(PROFILE_PRESENT_DEFAULT + scalingMode), Profiler::GetElapsedMs(presentStart));
+		Profiler::AddSample(PROFILE_SCENE, Profiler::GetElapsedMs(sceneStart));
+
+		if(Game::IsDebug()) ShowDebugInfo(*player);
+	}
 
+	Uint32 GetSceneTime()
+	{
+		return (Uint32)sceneTime;
+	}
+
+	bool IsHeadless()
+	{
+		return headless;
+	}
+
+	RenderStats GetRenderStats()
+	{
+		return renderQueue.GetStats();
+	}
+
+	void SetHeadless(bool toggle)
+	{
+		headless = toggle;
+	}
+
+	void BeginScene()
+	{
+		SDL_SetRenderTarget(renderer, scaled_scene);
+		SDL_RenderSetScale(renderer, (float)sceneScale, (float)sceneScale);
+	}
+
+	void EndScene()
+	{
+		if(scaled_scene)
+		{
+			// switching back to the window restores its own scale
 			SDL_SetRenderTarget(renderer, NULL);
 			SDL_RenderCopy(renderer, scaled_scene, NULL, NULL);
 		}
 		else
-		{
-			SDL_SetRenderTarget(renderer, NULL);
-			SDL_Rect dest;
-			dest.x = dest.y = 0;
-			dest.w = GAME_SCENE_WIDTH * RENDER_SCALE;
-			dest.h = GAME_SCENE_HEIGHT * RENDER_SCALE;
-			SDL_RenderCopy(renderer, unscaled_scene, NULL, &dest);
-		}
-
-		if(Game::IsDebug()) ShowDebugInfo(*player);
+			SDL_RenderSetScale(renderer, 1, 1);
 	}
 
 	void Cleanup()
 	{
-		SDL_DestroyTexture(unscaled_scene);
 		SDL_DestroyTexture(scaled_scene);
-		SDL_DestroyTexture(level_texture);
+		renderQueue.Clear();
+		spriteAtlas.Clear();
 		textureManager.Clear();
 		SDL_DestroyRenderer(renderer);
 		SDL_DestroyWindow(win);
@@ -530,11 +765,10 @@ namespace Graphics
 		rect.y = (int)(e.hitbox->GetPRect().y - camera->GetPRect().y);
 		rect.h = (int)e.hitbox->GetPRect().h;
 		rect.w = (int)e.hitbox->GetPRect().w;
-		SDL_SetRenderDrawColor(renderer, 230, 0, 0, 150);
-		SDL_RenderFillRect(renderer, &rect);
+		renderQueue.AddFill(RENDER_LAYER_DEBUG, { 230, 0, 0, 150 }, rect);
 	}
 
-	void Render(Entity &e)
+	void Render(Entity &e, RENDER_LAYERS layer)
 	{
 		SDL_Rect realpos;
 		double x, y;
@@ -544,12 +778,12 @@ namespace Graphics
 		realpos.h = (int)e.sprite->GetTextureCoords().h;
 		realpos.w = (int)e.sprite->GetTextureCoords().w;
 
-		if(e.status == STATUS_INVULN && SDL_GetTicks() % 200 > 100 && e.blinkDamaged) return;
+		if(e.status == STATUS_INVULN && GetSceneTime() % 200 > 100 && e.blinkDamaged) return;
 
 		SDL_RendererFlip flip = SDL_FLIP_NONE;
 		if(e.direction == DIRECTION_LEFT)
 			flip = SDL_FLIP_HORIZONTAL;
-		SDL_RenderCopyEx(renderer, e.sprite->GetSpriteSheet(), &e.sprite->GetTextureCoords(), &realpos, NULL, NULL, flip);
+		renderQueue.AddCopy(layer, textureManager.GetTexture(e.sprite->GetSpriteSheet()), e.sprite->GetTextureCoords(), realpos, flip);
 
 		if(Game::IsDebug())
 			DrawHitbox(e);
@@ -558,13 +792,11 @@ namespace Graphics
 	void UpdateAnimation(Bullet &b)
 	{
 		b.sprite->SetAnimation(ANIMATION_STANDING);
-		b.sprite->Animate();
 	}
 
 	void UpdateAnimation(Effect &e)
 	{
 		e.sprite->SetAnimation(ANIMATION_STANDING);
-		e.sprite->Animate();
 	}
 
 	bool had_shot_while_jumping = false;
@@ -609,7 +841,6 @@ namespace Graphics
 						}
 					}
 				}
-				p.sprite->Animate();
 				return;
 			}
 		}
@@ -629,7 +860,6 @@ namespace Graphics
 			case CREATURE_STATES::HANGING:
 			{
 				p.sprite->SetAnimation(ANIMATION_HANGING);
-				p.sprite->Animate();
 				return;
 			}
 		}
@@ -639,7 +869,6 @@ namespace Graphics
 			if(p.GetVelocity().x != 0)// && p.accel.x != 0)
 			{
 				p.sprite->SetAnimation(ANIMATION_RUNNING);
-				p.sprite->Animate();
 			}
 			else
 			{
@@ -652,7 +881,6 @@ namespace Graphics
 					p.sprite->SetAnimation(ANIMATION_STANDING);
 					p.idleTimer++;
 				}
-				p.sprite->Animate();
 			}
 		}
 		else
@@ -667,7 +895,6 @@ namespace Graphics
 				if(!had_shot_while_jumping)
 					p.sprite->SetAnimation(ANIMATION_JUMPING);
 			}
-			p.sprite->Animate();
 		}
 		/*
 			if(p.hasState(STATE_LOOKINGUP))
@@ -726,12 +953,10 @@ namespace Graphics
 			if(c.GetVelocity().x != 0)// && p.accel.x != 0)
 			{
 				c.sprite->SetAnimation(ANIMATION_RUNNING);
-				c.sprite->Animate();
 			}
 			else
 			{
 				c.sprite->SetAnimation(ANIMATION_STANDING);
-				c.sprite->Animate();
 			}
 		}
 		else
@@ -744,7 +969,6 @@ namespace Graphics
 			{
 				c.sprite->SetAnimation(ANIMATION_JUMPING);
 			}
-			c.sprite->Animate();
 		}
 	}
 
@@ -753,6 +977,36 @@ namespace Graphics
 
 	}
 
+	// Advances every visible entity sprite in one pass, after all of them picked their animation
+	void AnimateSprites(double ticks)
+	{
+		double ms = ticks * 1000 / SecToTicks(1);
+		VisibleEntities &visible = Visibility::GetVisible();
+		for(auto &dy : visible.machinery)
+			dy->sprite->AdvanceAnimation(ms);
+		for(auto &p : visible.pickups)
+			p->sprite->AdvanceAnimation(ms);
+		for(auto &c : visible.creatures)
+			c->sprite->AdvanceAnimation(ms);
+		Game::GetPlayer()->sprite->AdvanceAnimation(ms);
+		for(auto &e : visible.effects)
+			e->sprite->AdvanceAnimation(ms);
+		for(auto &b : visible.bullets)
+			b->sprite->AdvanceAnimation(ms);
+	}
+
+	// Part of the level seen on screen, letterbox bars excluded
+	SDL_Rect GetVisibleRect()
+	{
+		SDL_Rect view = camera->GetRect();
+		if(scalingMode == SCALING_LETTERBOXED)
+		{
+			SDL_Rect virtCam = camera->GetVirtualCamRect();
+			SDL_IntersectRect(&view, &virtCam, &view);
+		}
+		return view;
+	}
+
 	void ShowDebugInfo(Player &p)
 	{
 		int x, y, rectx, recty;
@@ -806,7 +1060,7 @@ namespace Graphics
 				posX = iter.second.location.x;
 				posY = iter.second.location.y;
 			}
-			if(iter.second.tex == NULL)	
+			if(iter.second.tex == INVALID_TEXTURE_HANDLE)
 				RenderText(posX, posY, iter.second.text, interface_font, interface_color);
 			else
 			{
@@ -815,7 +1069,7 @@ namespace Graphics
 				dest.y = posY;
 				dest.w = iter.second.location.w;
 				dest.h = iter.second.location.h;
-				SDL_RenderCopy(GetRenderer(), iter.second.tex, &iter.second.frame, &dest);
+				SDL_RenderCopy(GetRenderer(), textureManager.GetTexture(iter.second.tex), &iter.second.frame, &dest);
 			}
 		}
 	}
@@ -829,12 +1083,27 @@ namespace Graphics
 		switch(transition)
 		{
 			case TRANSITION_TITLE:
-				SDL_RenderCopy(renderer, *textureManager.GetTexture("assets/textures/title.png"), NULL, NULL);
+				SDL_RenderCopy(renderer, textureManager.GetTexture(titleTexture), NULL, NULL);
 				break;
 			case TRANSITION_LEVELCLEAR:
 				RenderText(GetWindowNormalizedX(0.5), GetWindowNormalizedY(0.5), "LEVEL CLEAR!", game_font, menu_color, TEXT_ALIGN_CENTER);
 				break;
 		}
+
+		if(!Preloader::IsDone())
+		{
+			// loading progress bar along the bottom of the screen
+			SDL_Rect bar;
+			bar.w = GetWindowNormalizedX(0.5);
+			bar.h = 4;
+			bar.x = GetWindowNormalizedX(0.5) - bar.w / 2;
+			bar.y = GetWindowNormalizedY(0.9);
+			SDL_SetRenderDrawColor(renderer, 60, 60, 60, 255);
+			SDL_RenderFillRect(renderer, &bar);
+			bar.w = (int)(bar.w * Preloader::GetProgress());
+			SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+			SDL_RenderFillRect(renderer, &bar);
+		}
 	}
 
 	void RenderLogo()
@@ -844,7 +1113,7 @@ namespace Graphics
 		r.h = 100;
 		r.x = GetWindowNormalizedX(0.5) - r.w / 2;
 		r.y = 30;
-		SDL_RenderCopy(renderer, *textureManager.GetTexture("assets/textures/logo.png"), NULL, &r);
+		SDL_RenderCopy(renderer, textureManager.GetTexture(logoTexture), NULL, &r);
 	}
 
 	void RenderMenu()
@@ -881,6 +1150,7 @@ namespace Graphics
 				RenderMenuItems(MENU_SELECTION_DISPLAY_MODE);
 				RenderMenuItems(MENU_SELECTION_FULLSCREEN);
 				RenderMenuItems(MENU_SELECTION_SCALING_MODE);
+				RenderMenuItems(MENU_SELECTION_FRAME_PACING);
 				break;
 			}
 			case MENU_BINDS:
@@ -1002,64 +1272,42 @@ namespace Graphics
 
 	void WindowUpdate()
 	{
+		redrawRequested = false;
 		SDL_RenderPresent(renderer);
 	}
 
-	void UpdateTileAnimations()
+	// All bolts on screen are drawn with one batched call per color row.
+	// Bolts get thinner as they fade out
+	void RenderLightnings()
 	{
-		for(auto &c : tileset)
+		for(auto &l : Visibility::GetVisible().lightnings)
 		{
-			if(c.animationData.sequence.size())
+			for(auto &r : lightningRects)
+				r.clear();
+			double x, y;
+			l->GetPos(x, y);
+			int originX = (int)(x - camera->GetPRect().x + l->sprite->GetSpriteOffsetX());
+			int originY = (int)(y - camera->GetPRect().y + l->sprite->GetSpriteOffsetY());
+			double timeLeft = l->statusTimer / l->lifetime;
+			int maxThickness = timeLeft > 0.66 ? 3 : timeLeft > 0.33 ? 2 : 1;
+
+			for(auto &p : l->bolt->points)
 			{
-				int numFrames = c.animationData.sequence.size();
-				int currentFrame = c.animationData.currentFrame;
-				int duration = c.animationData.sequence[currentFrame].duration;
-				Uint32 ticks = SDL_GetTicks();
-				Uint32 delta = ticks - c.animationData.timer;
-				if(delta > (unsigned)duration)
-				{
-					c.animationData.currentFrame++;
-					if(c.animationData.currentFrame >= numFrames)
-						c.animationData.currentFrame = 0;
-					c.animationData.timer = SDL_GetTicks();
-
-					c.animated_x_offset = tileset[c.animationData.sequence[currentFrame].id].x_offset;
-					c.animated_y_offset = tileset[c.animationData.sequence[currentFrame].id].y_offset;
-				}
+				if(p.x >= l->length)
+					break;
+				// mirrored the same way a flipped sprite would be
+				int px = l->direction ? originX + p.x : originX + l->length - 1 - p.x;
+				int thickness = std::min(p.thickness, maxThickness);
+				for(int row = 0; row < thickness; row++)
+					lightningRects[row].push_back({ px, originY + p.y - 1 + row, 1, 1 });
 			}
-		}
-	}
+			// one command per color, each ends up as one batched call
+			for(int row = 0; row < 3; row++)
+				renderQueue.AddFills(RENDER_LAYER_LIGHTNING, lightningColors[row], lightningRects[row]);
 
-	SDL_Texture* GenerateLightningTexture(std::vector<SDL_Point> &points)
-	{
-		int width = points.back().x;
-		SDL_Surface *lightning = SDL_CreateRGBSurface(0, width, 3 + 20, 32,
-			0x00FF0000,
-			0x0000FF00,
-			0x000000FF,
-			0xFF000000);
-		SDL_Rect src;
-		SDL_GetClipRect(lightningSegment, &src);
-		for(int i = 0; i < (int)points.size(); i++)
-		{
-			SDL_Point *p = &points[i];
-			SDL_Rect clone = src;
-			if(p->y > 512)
-			{
-				p->y -= 512;
-				clone.h = 1;
-			}
-			else if(p->y > 256)
-			{
-				p->y -= 256;
-				clone.h = 2;
-			}
-			SDL_Rect dest = { p->x, p->y - 1, 1, 3 };
-			SDL_BlitSurface(lightningSegment, &clone, lightning, &dest);
+			if(Game::IsDebug())
+				DrawHitbox(*l);
 		}
-		SDL_Texture *tex = SDL_CreateTextureFromSurface(renderer, lightning);
-		SDL_FreeSurface(lightning);
-		return tex;
 	}
 
 	int GetWindowNormalizedX(double val)
@@ -1137,7 +1385,8 @@ namespace Graphics
 
 	int LoadLevelTexturesFromFile(std::string fileName)
 	{
-		level_texture = IMG_LoadTexture(renderer, fileName.c_str());
+		// owned by the texture manager, so tilesets loaded ahead of time are reused
+		level_texture = textureManager.GetTexture(textureManager.LoadTexture(fileName));
 		return 0;
 	}
 
@@ -1188,29 +1437,22 @@ namespace Graphics
 
 	void DrawLetterbox()
 	{
-		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-		SDL_Rect rectToDraw;
 		SDL_Rect virtCam = camera->GetVirtualCamRect();
-		// top
-		rectToDraw.x = rectToDraw.y = 0;
-		rectToDraw.w = GAME_SCENE_WIDTH;
-		rectToDraw.h = virtCam.y - camera->GetPRect().y;
-		SDL_RenderFillRect(renderer, &rectToDraw);
-		// bottom
-		rectToDraw.x = 0;
-		rectToDraw.y = rectToDraw.h + virtCam.h;
-		rectToDraw.h = GAME_SCENE_HEIGHT - rectToDraw.y;
-		SDL_RenderFillRect(renderer, &rectToDraw);
-		// left
-		rectToDraw.x = rectToDraw.y = 0;
-		rectToDraw.h = GAME_SCENE_HEIGHT;
-		rectToDraw.w = virtCam.x - camera->GetPRect().x;
-		SDL_RenderFillRect(renderer, &rectToDraw);
-		// right
-		rectToDraw.y = 0;
-		rectToDraw.x = rectToDraw.w + virtCam.w;
-		rectToDraw.w = GAME_SCENE_WIDTH - rectToDraw.w;
-		SDL_RenderFillRect(renderer, &rectToDraw);		
+		SDL_Point offset = { (int)(virtCam.x - camera->GetPRect().x), (int)(virtCam.y - camera->GetPRect().y) };
+		if(offset.x != letterboxOffset.x || offset.y != letterboxOffset.y)
+		{
+			letterboxOffset = offset;
+			// top
+			letterboxRects[0] = { 0, 0, GAME_SCENE_WIDTH, offset.y };
+			// bottom
+			letterboxRects[1] = { 0, offset.y + virtCam.h, GAME_SCENE_WIDTH, GAME_SCENE_HEIGHT - offset.y - virtCam.h };
+			// left
+			letterboxRects[2] = { 0, 0, offset.x, GAME_SCENE_HEIGHT };
+			// right
+			letterboxRects[3] = { offset.x + virtCam.w, 0, GAME_SCENE_WIDTH - offset.x - virtCam.w, GAME_SCENE_HEIGHT };
+		}
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+		SDL_RenderFillRects(renderer, letterboxRects, 4);
 	}
 
 	SCALING_MODES GetScalingMode()
@@ -4,26 +4,49 @@
 #include <SDL.h>
 #include <SDL_ttf.h>
 #include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "camera.h"
 #include "entities.h"
 #include "globals.h"
+#include "renderqueue.h"
 
+// Textures live in a flat array indexed by handles. Names are only used to resolve handles
 class TextureManager
 {
 private:
-	std::map<std::string, SDL_Texture*> textures;
+	std::vector<SDL_Texture*> textures;
+	std::vector<std::string> names;
+	std::unordered_map<std::string, TextureHandle> handles;
+	std::vector<TextureHandle> freeHandles;
+
+	TextureHandle Register(const std::string &name, SDL_Texture *tex);
 
 public:
-	void LoadTexture(std::string filename);
-	void UnloadTexture(std::string filename);
-	bool IsLoaded(std::string filename);
-	SDL_Texture** GetTexture(std::string filename);
+	TextureHandle LoadTexture(const std::string &filename);
+	TextureHandle AddTexture(const std::string &name, SDL_Texture *tex);
+	TextureHandle AddTexture(SDL_Texture *tex);
+	void UnloadTexture(const std::string &filename);
+	void UnloadTexture(TextureHandle handle);
+	bool IsLoaded(const std::string &filename);
+	TextureHandle GetHandle(const std::string &filename);
+	SDL_Texture* GetTexture(TextureHandle handle)
+	{
+		if(handle < 0 || handle >= (int)textures.size())
+			return NULL;
+		return textures[handle];
+	}
 	void Clear();
 };
 
 namespace Graphics
 {
 	int Init();
+	void SetHeadless(bool toggle);
+	bool IsHeadless();
+	Uint32 GetSceneTime();
+	RenderStats GetRenderStats();
 	void Update(double ticks);
 	void Cleanup();
 
@@ -31,10 +54,10 @@ namespace Graphics
 	void CreateCamera();
 	void RemoveCamera();
 
-	void Render(Entity &e);
+	void Render(Entity &e, RENDER_LAYERS layer);
 	void DrawHitbox(Entity &e);
 
-	void DrawFPS(long long dt);
+	void DrawFPS(double frameTime);
 	void ShowDebugInfo(Player &p);
 	void UpdateDisplayMode();
 	void RenderInterface();
@@ -48,11 +71,12 @@ namespace Graphics
 	void UpdateAnimation(Player &p, double ticks);
 	void UpdateAnimation(Creature &c);
 	void UpdateAnimation(Pickup &p);
+	void AnimateSprites(double ticks);
+	SDL_Rect GetVisibleRect();
 	void DrawFading();
 	void WindowFlush();
 	void WindowUpdate();
-	void UpdateTileAnimations();
-	SDL_Texture* GenerateLightningTexture(std::vector<SDL_Point> &points);
+	void RenderLightnings();
 	void ChangePlayerColor(PLAYER_BODY_PARTS bodyPart, SDL_Color color);
 	void InitPlayerTexture();
 	int GetWindowNormalizedX(double val);
@@ -77,5 +101,8 @@ namespace Graphics
 	void DrawLetterbox();
 	SCALING_MODES GetScalingMode();
 	void SetScalingMode(int mode);
+	void BuildSpriteAtlas();
+	void RequestRedraw();
+	bool IsRedrawRequested();
 }
 #endif
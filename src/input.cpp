@@ -6,6 +6,8 @@
 #include "level.h"
 #include "menu.h"
 #include "physics.h"
+#include "replay.h"
+#include "savestate.h"
 #include "sound.h"
 #include "transition.h"
 #include "utils.h"
@@ -40,6 +42,9 @@ void InitInput()
 
 bool IsBindPressed(KEYBINDS bind)
 {
+	// the recorded binds, so real devices can't change how a replay plays out
+	if(Replay::IsPlaying())
+		return Replay::IsBindHeld(bind);
 	if(kb_keys[bind] || j_buttons[bind])
 		return true;
 	return false;
@@ -52,6 +57,7 @@ bool OnBindPress(int bind)
 	switch(Game::GetState())
 	{
 		case STATE_GAME:
+			Replay::RecordBind(bind, true);
 			Game::GetPlayer()->HandleInput(bind, 0);
 
 			// end inputs affected by player state
@@ -99,6 +105,7 @@ void OnBindUnpress(int bind)
 {
 	if(Game::GetState() == STATE_GAME)
 	{
+		Replay::RecordBind(bind, false);
 		Game::GetPlayer()->HandleInput(bind, 2);
 	}
 }
@@ -111,6 +118,20 @@ void OnBindHold(int bind)
 	}
 }
 
+// A playing replay brings its own gameplay input, so the binds of real
+// devices are dropped. Only pausing is left to the viewer
+bool IsReplayControlled()
+{
+	return Replay::IsPlaying() && Game::GetState() == STATE_GAME;
+}
+
+bool OnReplayBindPress(int bind)
+{
+	if(Fading::GetState() != FADING_STATE_BLACKNBACK && (bind == BIND_BACK || bind == BIND_ESCAPE))
+		Game::ChangeState(STATE_PAUSED);
+	return true;
+}
+
 void OnHardcodedKeyPress(SDL_Keycode key, Uint8 jbutton)
 {
 	if(Fading::GetState() == FADING_STATE_BLACKNBACK)
@@ -124,6 +145,10 @@ void OnHardcodedKeyPress(SDL_Keycode key, Uint8 jbutton)
 	switch(Game::GetState())
 	{
 		case STATE_GAME:
+			if(key == SDLK_F5)
+				SaveState::QuickSave();
+			else if(key == SDLK_F9)
+				SaveState::QuickLoad();
 		// debug!!
 		/*if(IsDebugMode || kb_keys[SDLK_LSHIFT] || kb_keys[SDLK_RSHIFT])
 		{
@@ -209,7 +234,10 @@ void OnKeyPress(SDL_Keycode key, Uint8 jbutton)
 	bool inputHandled = false;
 	if(bind != -1)
 	{
-		inputHandled = OnBindPress(bind);
+		if(IsReplayControlled())
+			inputHandled = OnReplayBindPress(bind);
+		else
+			inputHandled = OnBindPress(bind);
 		if(jbutton != 255)
 			j_buttons[(KEYBINDS)bind] = KEYSTATE_PRESSED;
 		else
@@ -238,7 +266,8 @@ void OnKeyUnpress(SDL_Keycode key, Uint8 jbutton)
 
 	//inputEvents.push_back(bind, KEYSTATE_UNPRESSED);
 
-	OnBindUnpress(bind);
+	if(!IsReplayControlled())
+		OnBindUnpress(bind);
 }
 
 void OnKeyHold(SDL_Keycode key, Uint8 jbutton)
@@ -251,11 +280,17 @@ void OnKeyHold(SDL_Keycode key, Uint8 jbutton)
 	OnBindHold(bind);
 }
 
-void InputUpdate()
+// Returns true if there were any events
+bool InputUpdate()
 {
+	bool hadEvents = false;
 	SDL_Event e;
 	while(SDL_PollEvent(&e))
 	{
+		// only there to wake the main loop up, see Sound::OnMusicFinished
+		if(e.type == SDL_USEREVENT)
+			continue;
+		hadEvents = true;
 		if(!e.key.repeat || (e.key.repeat && Game::GetState() == GAMESTATES::STATE_MENU))
 		{
 			switch(e.type)
@@ -285,14 +320,15 @@ void InputUpdate()
 	}
 	for(auto key : kb_keys)
 	{
-		if(key.second == KEYSTATE_PRESSED)
+		if(key.second == KEYSTATE_PRESSED && !IsReplayControlled())
 			OnBindHold(key.first);
 	}
 	for(auto jbutton : j_buttons)
 	{
-		if(jbutton.second == KEYSTATE_PRESSED)
+		if(jbutton.second == KEYSTATE_PRESSED && !IsReplayControlled())
 			OnBindHold(jbutton.first);
 	}
+	return hadEvents;
 }
 
 void InputCleanup()
@@ -13,7 +13,7 @@ void OnKeyHold(SDL_Keycode key, Uint8 jbutton);
 void OnKeyUnpress(SDL_Keycode key, Uint8 jbutton);
 void OnHardcodedKeyPress(SDL_Keycode key, Uint8 jbutton);
 
-void InputUpdate();
+bool InputUpdate();
 void InitInput();
 void InputCleanup();
 
@@ -11,9 +11,11 @@
 // int - which part of the interface this is (affects draw priority)
 // SDL_Rect* - the part of the texture being used (allows different drawn frames)
 // SDL_Rect* - where on the screen the interface part will draw
-// SDL_Texture* - the actual texture being drawn
+// TextureHandle - the actual texture being drawn, owned by the texture manager
 std::map<int, InterfacePiece> interfaces;
 
+extern TextureManager textureManager;
+
 std::map<int, InterfacePiece>* GetInterfaces()
 {
 	return &interfaces;
@@ -59,7 +61,7 @@ void ChangeInterfaceFrame(int frame, int part)
 		PrintLog(LOG_DEBUG, "Attempted to change interface frame for unexisting interface");
 		return;
 	}
-	interfaces.at(part).frame.x = interfaces.at(part).frame.w * frame;
+	interfaces.at(part).frame.x = interfaces.at(part).origin.x + interfaces.at(part).frame.w * frame;
 }
 
 void BuildInterface(int h, int w, int x, int y, const char* content, int frame, int part)
@@ -79,10 +81,14 @@ void BuildInterface(int h, int w, int x, int y, const char* content, int frame,
 	if(frame == -1) // null frame, treat as text
 	{
 		interfaces[part].text = content;
-		interfaces[part].tex = NULL;
+		interfaces[part].tex = INVALID_TEXTURE_HANDLE;
 	}
 	else
-		interfaces[part].tex = IMG_LoadTexture(Graphics::GetRenderer(), content);
+	{
+		interfaces[part].textureFile = content;
+		interfaces[part].tex = textureManager.LoadTexture(content);
+	}
+	interfaces[part].origin = { 0, 0 };
 
 	interfaces[part].frame = f;
 	interfaces[part].location = r;
@@ -90,7 +96,6 @@ void BuildInterface(int h, int w, int x, int y, const char* content, int frame,
 
 void InterfaceCleanup()
 {
-	for(auto i : interfaces)
-		SDL_DestroyTexture(i.second.tex);
+	// textures are freed by the texture manager
 	std::map<int, InterfacePiece>().swap(interfaces); // forcibly deallocate memory
 }
\ No newline at end of file
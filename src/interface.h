@@ -4,12 +4,15 @@
 #include <SDL.h>
 #include <map>
 #include <string>
+#include "globals.h"
 
 struct InterfacePiece
 {
 	SDL_Rect frame;
 	SDL_Rect location;
-	SDL_Texture *tex;
+	TextureHandle tex;
+	std::string textureFile;
+	SDL_Point origin; // position of the first frame in the texture
 	std::string text;
 };
 
@@ -5,6 +5,9 @@
 #include "globals.h"
 #include "gamelogic.h"
 #include "graphics.h"
+#include "navigation.h"
+#include "savestate.h"
+#include "streaming.h"
 #include "tiles.h"
 #include "tinyxml.h"
 #include "utils.h"
@@ -22,6 +25,7 @@ struct EnemyLoadData
 	int distanceToReachX;
 	int distanceToReachY;
 	std::string facing;
+	bool spawned;
 };
 
 struct PickupLoadData
@@ -29,6 +33,7 @@ struct PickupLoadData
 	int x;
 	int y;
 	PICKUP_TYPES type;
+	bool spawned;
 };
 
 struct PlatformLoadData
@@ -49,6 +54,28 @@ extern std::vector<TileLayerData> tileLayers;
 
 std::vector<std::vector<int>> tiles;
 
+// What the level looked like right after loading, so restarting doesn't have to parse the map again
+struct LevelSnapshot
+{
+	std::vector<std::vector<Uint16>> layerGids;
+	std::vector<std::vector<int>> collision;
+};
+
+LevelSnapshot snapshot;
+
+// Navigation profiles are made for every enemy placed in the level, not
+// only the ones spawned so far, so streaming one in doesn't build edges mid-frame
+void BuildNavigation()
+{
+	std::vector<std::string> types;
+	for(auto &e : levelEnemies)
+	{
+		if(!e.AItype.empty())
+			types.push_back(e.type);
+	}
+	Navigation::Build(types);
+}
+
 Level::Level()
 {
 	fileName = "test.tmx";
@@ -66,10 +93,10 @@ void Level::Init()
 	loaded = false;
 
 	LoadLevelFromFile(fileName);
+	TakeSnapshot();
 
-	LoadNonRandomElements();
-	LoadEnemies();
-	LoadEntities();
+	SpawnAll();
+	BuildNavigation();
 
 	width_in_pix = width_in_tiles * TILESIZE;
 	height_in_pix = height_in_tiles * TILESIZE;
@@ -171,6 +198,7 @@ void Level::LoadLevelFromFile(std::string filename)
 			tileset[id].animationData.sequence.push_back(TileFrame{ tileid, duration });
 		}
 	}
+	InitTileAnimations(Graphics::GetSceneTime());
 
 	int layerNum = 0;
 	for(TiXmlElement* curLayer = node->FirstChildElement("layer"); curLayer != NULL; curLayer = curLayer->NextSiblingElement("layer"))
@@ -194,7 +222,7 @@ void Level::LoadLevelFromFile(std::string filename)
 		if(tmp != NULL)
 			tileLayerData.parallaxDepthY = atof(tmp);
 
-		tileLayerData.tiles = std::vector<std::vector<Tile*>>(this->width_in_tiles, std::vector<Tile*>(this->height_in_tiles));
+		tileLayerData.Resize(this->width_in_tiles, this->height_in_tiles);
 		tileLayers.push_back(tileLayerData);
 		
 		int tileColumn = 0;
@@ -208,9 +236,11 @@ void Level::LoadLevelFromFile(std::string filename)
 				type = 0;
 			else
 				type = SDL_atoi(gid);
-			if(type)
+			// tile objects are created by Streaming once the camera gets close
+			if(type && tileRow < this->height_in_tiles)
 			{
-				new Tile(tileColumn, tileRow, layerNum, &tileset[type - 1], true);
+				tileLayers[layerNum].GidAt(tileColumn, tileRow) = (Uint16)type;
+				tiles[tileColumn][tileRow] = tileset[type - 1].type;
 			}
 			tileColumn++;
 			if(tileColumn >= this->width_in_tiles)
@@ -285,7 +315,7 @@ void Level::LoadLevelFromFile(std::string filename)
 					else if(propName == "facing")
 						facing = curProp->Attribute("value");
 				}
-				levelEnemies.push_back(EnemyLoadData{ x, y, name, AItype, distanceToReachX, distanceToReachY, facing });
+				levelEnemies.push_back(EnemyLoadData{ x, y, name, AItype, distanceToReachX, distanceToReachY, facing, false });
 			}
 		}
 		if(type == "platform")
@@ -351,6 +381,7 @@ void Level::LoadLevelFromFile(std::string filename)
 			data.x = x;
 			data.y = y;
 			data.type = type;
+			data.spawned = false;
 			levelPickups.push_back(data);
 		}
 		if(type == "path")
@@ -389,16 +420,154 @@ void Level::LoadLevelFromFile(std::string filename)
 	}
 }
 
+void Level::TakeSnapshot()
+{
+	snapshot.layerGids.clear();
+	for(auto &layer : tileLayers)
+		snapshot.layerGids.push_back(layer.gids);
+	snapshot.collision = tiles;
+}
+
+// Puts the player, entities and streamed sectors back to the start
+void Level::SpawnAll()
+{
+	LoadNonRandomElements();
+	LoadEntities();
+	// enemies and pickups come with the sectors around the player
+	SDL_Rect area = { playerSpawn.x - VIRTUAL_CAM_WIDTH / 2, playerSpawn.y - VIRTUAL_CAM_HEIGHT / 2, VIRTUAL_CAM_WIDTH, VIRTUAL_CAM_HEIGHT };
+	SDL_Rect view = Graphics::GetCamera()->GetRect();
+	view.x = playerSpawn.x - view.w / 2;
+	view.y = playerSpawn.y - view.h / 2;
+	Streaming::Start(*this, area, view);
+}
+
+// Restores the level from its snapshot. The map isn't parsed again and the
+// tileset stays loaded. The navigation graph is only built again when tiles
+// were removed
 void Level::Reload()
 {
-	Cleanup();
-	Init();
+	loaded = false;
+	ResetToSnapshot();
+	SpawnAll();
+	loaded = true;
+}
+
+// Removes everything spawned and puts the tile data back the way it was
+// loaded, nothing is spawned again
+void Level::ResetToSnapshot()
+{
+	Streaming::Cleanup();
+	UnloadEntities();
+	UnloadTiles();
+
+	for(int i = 0; i < (int)tileLayers.size(); i++)
+		tileLayers[i].gids = snapshot.layerGids[i];
+	bool collisionChanged = tiles != snapshot.collision;
+	tiles = snapshot.collision;
+	if(collisionChanged)
+		BuildNavigation();
+	for(auto &e : levelEnemies)
+		e.spawned = false;
+	for(auto &p : levelPickups)
+		p.spawned = false;
+	InitTileAnimations(Graphics::GetSceneTime());
+	Game::Reset();
+}
+
+// Only tiles that differ from the snapshot are saved
+void Level::SaveState(StateWriter &w)
+{
+	w.Write((Uint32)tileLayers.size());
+	for(int i = 0; i < (int)tileLayers.size(); i++)
+	{
+		std::vector<Uint16> &gids = tileLayers[i].gids;
+		std::vector<Uint32> changed;
+		for(Uint32 j = 0; j < gids.size(); j++)
+		{
+			if(gids[j] != snapshot.layerGids[i][j])
+				changed.push_back(j);
+		}
+		w.Write((Uint32)changed.size());
+		for(auto j : changed)
+		{
+			w.Write(j);
+			w.Write(gids[j]);
+		}
+	}
+
+	std::vector<SDL_Point> changed;
+	for(int x = 0; x < (int)tiles.size(); x++)
+	{
+		for(int y = 0; y < (int)tiles[x].size(); y++)
+		{
+			if(tiles[x][y] != snapshot.collision[x][y])
+				changed.push_back({ x, y });
+		}
+	}
+	w.Write((Uint32)changed.size());
+	for(auto &i : changed)
+	{
+		w.Write(i);
+		w.Write(tiles[i.x][i.y]);
+	}
+
+	w.Write((Uint32)levelEnemies.size());
+	for(auto &e : levelEnemies)
+		w.Write(e.spawned);
+	w.Write((Uint32)levelPickups.size());
+	for(auto &p : levelPickups)
+		w.Write(p.spawned);
+}
+
+// Goes after ResetToSnapshot, before the tiles get streamed in
+bool Level::LoadState(StateReader &r)
+{
+	if(r.Read<Uint32>() != tileLayers.size())
+		return false;
+	for(auto &layer : tileLayers)
+	{
+		Uint32 count = r.Read<Uint32>();
+		for(Uint32 j = 0; j < count && !r.Failed(); j++)
+		{
+			Uint32 at = r.Read<Uint32>();
+			Uint16 gid = r.Read<Uint16>();
+			if(at >= layer.gids.size() || gid > tileset.size())
+				return false;
+			layer.gids[at] = gid;
+		}
+	}
+
+	Uint32 count = r.Read<Uint32>();
+	for(Uint32 j = 0; j < count && !r.Failed(); j++)
+	{
+		SDL_Point at = r.Read<SDL_Point>();
+		int type = r.Read<int>();
+		if(at.x < 0 || at.x >= (int)tiles.size() || at.y < 0 || at.y >= (int)tiles[at.x].size())
+			return false;
+		tiles[at.x][at.y] = type;
+	}
+	// node numbers of saved paths are those of the saved collision
+	if(count > 0)
+		BuildNavigation();
+
+	if(r.Read<Uint32>() != levelEnemies.size())
+		return false;
+	for(auto &e : levelEnemies)
+		r.Read(e.spawned);
+	if(r.Read<Uint32>() != levelPickups.size())
+		return false;
+	for(auto &p : levelPickups)
+		r.Read(p.spawned);
+	return !r.Failed();
 }
 
 void Level::Cleanup()
 {
+	Streaming::Cleanup();
 	DeleteAllTiles();
 	tileset.clear();
+	InitTileAnimations(0);
+	Navigation::Cleanup();
 	UnloadEntities();
 	entitySpawns.clear();
 	levelEnemies.clear();
@@ -407,6 +576,7 @@ void Level::Cleanup()
 	CameraBounds.clear();
 	deathZones.clear();
 	paths.clear();
+	snapshot = LevelSnapshot();
 	Game::Reset();
 }
 
@@ -421,10 +591,15 @@ void Level::UnloadEntities()
 	Game::RemovePlayer();
 }
 
-void Level::LoadEnemies()
+// Spawns the enemies placed within an area, each one only once
+void Level::LoadEnemies(SDL_Rect area)
 {
 	for(auto &e : levelEnemies)
 	{
+		SDL_Point at = { e.x, e.y };
+		if(e.spawned || !SDL_PointInRect(&at, &area))
+			continue;
+		e.spawned = true;
 		Creature *c;
 		c = new Creature(e.type);
 		if(c == nullptr)
@@ -433,27 +608,7 @@ void Level::LoadEnemies()
 			continue;
 		}
 		c->SetPos(e.x, e.y);
-		if(e.AItype == "Chaser")
-			c->SetAI<AI_Chaser>();
-		else if(e.AItype == "ChaserJumper")
-			c->SetAI<AI_ChaserJumper>();
-		else if(e.AItype == "Wanderer")
-			c->SetAI<AI_Wanderer>();
-		else if(e.AItype == "HomingMissile")
-			c->SetAI<AI_HomingMissile>();
-		else if(e.AItype == "Hypno")
-			c->SetAI<AI_Hypno>();
-		else if(e.AItype == "Liner")
-			c->SetAI<AI_Liner>();
-		else if(e.AItype == "Sentinel")
-			c->SetAI<AI_Sentinel>();
-		else if(e.AItype == "Anvil")
-			c->SetAI<AI_Anvil>();
-		else if(e.AItype == "Jumpingfire")
-			c->SetAI<AI_Jumpingfire>();
-		else if(e.AItype == "GroundShockwaver")
-			c->SetAI<AI_GroundShockwaver>();
-		else
+		if(!c->SetAI(e.AItype))
 		{
 			PrintLog(LOG_IMPORTANT, "Invalid AI type %s", e.AItype.c_str());
 			continue;
@@ -472,14 +627,29 @@ void Level::LoadEnemies()
 	}
 }
 
-void Level::LoadEntities()
+void Level::LoadPickups(SDL_Rect area)
 {
-	for(auto p : levelPickups)
+	for(auto &p : levelPickups)
 	{
+		SDL_Point at = { p.x, p.y };
+		if(p.spawned || !SDL_PointInRect(&at, &area))
+			continue;
+		p.spawned = true;
 		Pickup *pi = new Pickup(p.type);
 		pi->SetPos(p.x, p.y);
 	}
+}
+
+// Called by Streaming when the area comes close to the camera for the first time
+void Level::SpawnEntities(SDL_Rect area)
+{
+	LoadEnemies(area);
+	LoadPickups(area);
+}
 
+// Platforms and doors move or get triggered from afar, they're loaded with the level
+void Level::LoadEntities()
+{
 	for(auto p : levelPlatforms)
 	{
 		new Platform(p.x, p.y, p.type, p.pathID, p.speed);
@@ -9,6 +9,9 @@
 
 #define TILESIZE 16
 
+class StateReader;
+class StateWriter;
+
 class Level
 {
 	public:
@@ -33,10 +36,17 @@ class Level
 		void Init();
 		void Cleanup();
 		void Reload();
+		void TakeSnapshot();
+		void ResetToSnapshot();
+		void SaveState(StateWriter &w);
+		bool LoadState(StateReader &r);
+		void SpawnAll();
 		void UnloadEntities();
 		~Level();
 		void LoadLevelFromFile(std::string filename);
-		void LoadEnemies();
+		void LoadEnemies(SDL_Rect area);
+		void LoadPickups(SDL_Rect area);
+		void SpawnEntities(SDL_Rect area);
 		void LoadEntities();
 		void LoadPlayer();
 		void LoadNonRandomElements();
@@ -0,0 +1,88 @@
+#include "lineofsight.h"
+#include <cmath>
+#include <unordered_map>
+#include "entities.h"
+#include "level.h"
+#include "physics.h"
+#include "tiles.h"
+
+namespace LineOfSight
+{
+	std::unordered_map<Uint64, bool> cache;
+
+	bool BlocksSight(int x, int y)
+	{
+		PHYSICS_TYPES type = GetTileTypeAtTiledPos(x, y);
+		return type == PHYSICS_OB || IsSolid(type);
+	}
+
+	// Visits tiles the ray crosses one by one (DDA) and stops at the first one
+	// blocking it. The end tiles don't count, entities can overlap walls a bit
+	bool CastRay(SDL_Point from, SDL_Point to)
+	{
+		int dx = to.x - from.x;
+		int dy = to.y - from.y;
+		int stepX = dx > 0 ? 1 : -1;
+		int stepY = dy > 0 ? 1 : -1;
+		// ray parameter (0 to 1) at which the next tile border is crossed on each axis
+		double deltaX = dx ? 1.0 / abs(dx) : INFINITY;
+		double deltaY = dy ? 1.0 / abs(dy) : INFINITY;
+		double nextX = deltaX / 2;
+		double nextY = deltaY / 2;
+
+		int x = from.x, y = from.y;
+		int steps = abs(dx) + abs(dy);
+		for(int i = 1; i < steps; i++)
+		{
+			if(nextX < nextY)
+			{
+				x += stepX;
+				nextX += deltaX;
+			}
+			else
+			{
+				y += stepY;
+				nextY += deltaY;
+			}
+			if(BlocksSight(x, y))
+				return false;
+		}
+		return true;
+	}
+
+	void BeginFrame()
+	{
+		cache.clear();
+	}
+
+	bool IsClearTiled(SDL_Point from, SDL_Point to)
+	{
+		if(from.x < 0 || from.y < 0 || to.x < 0 || to.y < 0)
+			return false;
+		// tile coords fit in 16 bits
+		Uint64 key = ((Uint64)(Uint16)from.x << 48) | ((Uint64)(Uint16)from.y << 32) | ((Uint64)(Uint16)to.x << 16) | (Uint16)to.y;
+		auto cached = cache.find(key);
+		if(cached != cache.end())
+			return cached->second;
+		bool clear = CastRay(from, to);
+		cache[key] = clear;
+		return clear;
+	}
+
+	bool IsClear(SDL_Point from, SDL_Point to)
+	{
+		return IsClearTiled({ (int)floor(from.x / (double)TILESIZE), (int)floor(from.y / (double)TILESIZE) },
+			{ (int)floor(to.x / (double)TILESIZE), (int)floor(to.y / (double)TILESIZE) });
+	}
+
+	SDL_Point GetCenter(Entity &e)
+	{
+		SDL_Rect rect = e.hitbox->GetRect();
+		return { rect.x + rect.w / 2, rect.y + rect.h / 2 };
+	}
+
+	bool CanSee(Entity &from, Entity &to)
+	{
+		return IsClear(GetCenter(from), GetCenter(to));
+	}
+}
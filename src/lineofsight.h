@@ -0,0 +1,20 @@
+#ifndef _lineofsight_h_
+#define _lineofsight_h_
+
+#include <SDL.h>
+
+class Entity;
+
+// Whether anything solid stands between two points of the level. Rays go
+// between the centers of the tiles the points are in, so results are cached
+// by tile pair until the next frame.
+namespace LineOfSight
+{
+	void BeginFrame();
+	bool IsClearTiled(SDL_Point from, SDL_Point to);
+	bool IsClear(SDL_Point from, SDL_Point to);
+	SDL_Point GetCenter(Entity &e);
+	bool CanSee(Entity &from, Entity &to);
+}
+
+#endif
@@ -1,27 +1,48 @@
 #include "main.h"
 #include <SDL.h>
 #include <SDL_mixer.h>
-#include <chrono>
-#include <thread>
 //#include <vld.h>
+#include "benchmark.h"
 #include "config.h"
+#include "entitycache.h"
+#include "framepacing.h"
 #include "gamelogic.h"
+#include "golden.h"
 #include "graphics.h"
 #include "input.h"
 #include "interface.h"
 #include "level.h"
 #include "menu.h"
+#include "preloader.h"
+#include "profiler.h"
+#include "replay.h"
 #include "sound.h"
 #include "tiles.h"
 #include "transition.h"
 #include "utils.h"
+#include "visibility.h"
 
 
 void Cleanup();
 
+// How long to wait for events on a static screen before checking the state again, in ms
+int const IDLE_WAIT_TIME = 100;
+
 int main(int argc, char* argv[])
 {
 	//VLDEnable();
+	// only compiles the entity data, nothing else is started
+	if(EntityCache::ParseArgs(argc, argv))
+		return EntityCache::Build() ? 0 : 1;
+	Replay::ParseArgs(argc, argv);
+	if(Benchmark::ParseArgs(argc, argv) || GoldenFrames::ParseArgs(argc, argv) || Replay::IsFastForward())
+	{
+		// no display or sound card needed, unless the environment asks for a real one
+		SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+		SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+		Graphics::SetHeadless(true);
+	}
+
 	// Initialize SDL.
 	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER) < 0)
 		return 1;
@@ -38,36 +59,81 @@ int main(int argc, char* argv[])
 	// Loading textures and tilesets
 	Graphics::Init();
 
-	// Load creature properties and their sprite data
-	ReadCreatureData();
-	// TODO: Combine this somehow
-	ReadPlatformData();
+	// Load creature and platform properties and their sprite data
+	EntityCache::Init();
+	// Pack entity and interface sprite sheets into a few shared textures
+	Graphics::BuildSpriteAtlas();
+	// Lightning shots pick one of the pre-generated bolts
+	BuildLightningLibrary();
+	// Decode the rest of the assets in the background while the title is shown
+	Preloader::Start("assets/data/preload.ini");
 
 	// Setting game state
-	SetCurrentTransition(TRANSITION_TITLE);
-	Game::SetState(STATE_TRANSITION);
+	if(Benchmark::IsEnabled())
+		Benchmark::Start();
+	else if(GoldenFrames::IsEnabled())
+	{
+		if(!GoldenFrames::Start())
+			Game::SetGameEndFlag();
+	}
+	else if(Replay::IsPlaybackRequested())
+	{
+		if(!Replay::Start())
+			Game::SetGameEndFlag();
+	}
+	else
+	{
+		SetCurrentTransition(TRANSITION_TITLE);
+		Game::SetState(STATE_TRANSITION);
+	}
 
-	// Fixed time step game loop wizardry
-	using namespace std::chrono_literals;
-	using clock = std::chrono::high_resolution_clock;
-	auto timeStart_graphics = clock::now();
 	// main loop
 	while(!Game::IsGameEndRequested())
 	{
-		InputUpdate();
+		FramePacing::BeginFrame();
+
+		if(InputUpdate())
+			Graphics::RequestRedraw();
 
-		double ticksMultiplier = 1. / (Graphics::GetRefreshRate() / 60.);
+		Preloader::Update();
+
+		double ticksMultiplier = FramePacing::GetTicksMultiplier();
+		// every benchmark run simulates the same frames
+		if(Benchmark::IsEnabled())
+			ticksMultiplier = 1;
 
 		if(Fading::GetState() != FADING_STATE_NONE)
+		{
 			Fading::Update(ticksMultiplier);
+			Graphics::RequestRedraw();
+		}
+
+		// Menus and transitions don't change on their own, so when nothing happened
+		// there is no need to draw them again. Sleep until the next event instead
+		bool staticScreen = Game::GetState() == STATE_MENU || Game::GetState() == STATE_TRANSITION;
+		if(staticScreen && !Graphics::IsRedrawRequested() && !Game::IsDebug() && !Graphics::IsHeadless())
+		{
+			Sound::ProcessMusic();
+			SDL_WaitEventTimeout(NULL, IDLE_WAIT_TIME);
+			FramePacing::ResetClock();
+			continue;
+		}
 
 		if(Game::GetState() == STATE_GAME && Fading::GetState() != FADING_STATE_BLACKNBACK)
 		{
+			// replays bring their own input and frame lengths
+			if(Replay::IsPlaying())
+				ticksMultiplier = Replay::PlayFrame();
+			else
+				Replay::RecordFrame(ticksMultiplier);
+			Uint64 simulationStart = Profiler::GetTime();
 			Game::Update(ticksMultiplier);
+			Profiler::AddSample(PROFILE_SIMULATION, Profiler::GetElapsedMs(simulationStart));
 		}
-
-		auto deltaTime_graphics = clock::now() - timeStart_graphics;
-		timeStart_graphics = clock::now();
+		Replay::Update();
+		// nothing is drawn while fast-forwarding
+		if(Replay::IsFastForward())
+			continue;
 
 		Graphics::WindowFlush();
 		if(Game::GetState() == STATE_GAME || Game::GetState() == STATE_PAUSED)
@@ -86,21 +152,36 @@ int main(int argc, char* argv[])
 		if(Game::GetState() == STATE_PAUSED)
 			Graphics::RenderMenuItems(MENU_PAUSE);
 		if(Game::IsDebug())
-			Graphics::DrawFPS(deltaTime_graphics.count());
+			Graphics::DrawFPS(Profiler::GetStat(PROFILE_FRAME).last);
+		GoldenFrames::OnFrameRendered(Graphics::GetRenderer());
 		Graphics::WindowUpdate();
 		// Workaround to allow for gapless ogg looping without bugs
 		Sound::ProcessMusic();
-		// prevent 100% usage of cpu
-		// no longer needed because of vsync
-		//std::this_thread::sleep_for(std::chrono::nanoseconds(1));
+		// Waits for the next frame unless vsync or uncapped mode takes care of it
+		FramePacing::EndFrame();
+		if(Benchmark::IsEnabled())
+			Benchmark::EndFrame(Graphics::GetRenderStats());
+	}
+
+	int exitCode = 0;
+	if(Benchmark::IsEnabled())
+		Benchmark::Report();
+	else if(GoldenFrames::IsEnabled())
+	{
+		GoldenFrames::Report();
+		exitCode = GoldenFrames::GetFailures() ? 1 : 0;
 	}
+	else if(Replay::IsFastForward())
+		Replay::Report();
+	else if(Game::IsDebug())
+		Profiler::Report();
 
 	// I'm not sure if this is even necessary since the program is about to quit and lose all memory anyway
 	// I mostly used it to get VLD to stop yelling at me :D
 	Cleanup();
 	//VLDReportLeaks();
 
-	return 0;
+	return exitCode;
 }
 
 void Cleanup()
@@ -108,9 +189,12 @@ void Cleanup()
 	// let each file handle their own disposing (avoids giant bulky function)
 	try
 	{
+		Preloader::Cleanup();
 		Graphics::Cleanup();
 		Game::RemoveLevel();
+		Replay::Cleanup();
 		EntityCleanup();
+		Visibility::Cleanup();
 		InputCleanup();
 		BindsCleanup();
 		TilesCleanup();
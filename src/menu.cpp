@@ -1,5 +1,6 @@
 #include "menu.h"
 #include <sstream>
+#include "framepacing.h"
 #include "gamelogic.h"
 #include "graphics.h"
 #include "level.h"
@@ -88,7 +89,7 @@ void DoMenuAction(int kbkey, int jbutton, int bind)
 						// Calling it once more (SDL bug workaround)
 						Graphics::UpdateDisplayMode();
 					}
-					if(SelectedItem == 4)
+					if(SelectedItem == 5)
 						SetCurrentMenu(MENU_OPTIONS);
 				}
 				else if(CurrentMenu == MENU_SOUND_OPTIONS)
@@ -235,6 +236,11 @@ void NavigateMenu(int bind)
 					Graphics::UpdateDisplayMode();
 					RefreshDisplayModeMenus();
 				}
+				else if(SelectedItem == 4)
+				{
+					menus.at(MENU_SELECTION_FRAME_PACING)->selected <= 0 ? menus.at(MENU_SELECTION_FRAME_PACING)->selected = (menus.at(MENU_SELECTION_FRAME_PACING)->GetItemCount() - 1) : menus.at(MENU_SELECTION_FRAME_PACING)->selected--;
+					FramePacing::SetMode(menus.at(MENU_SELECTION_FRAME_PACING)->selected);
+				}
 			}
 			break;
 		case BIND_RIGHT: case BIND_ARROWR:
@@ -283,6 +289,11 @@ void NavigateMenu(int bind)
 					Graphics::UpdateDisplayMode();
 					RefreshDisplayModeMenus();
 				}
+				else if(SelectedItem == 4)
+				{
+					menus.at(MENU_SELECTION_FRAME_PACING)->selected >= (menus.at(MENU_SELECTION_FRAME_PACING)->GetItemCount() - 1) ? menus.at(MENU_SELECTION_FRAME_PACING)->selected = 0 : menus.at(MENU_SELECTION_FRAME_PACING)->selected++;
+					FramePacing::SetMode(menus.at(MENU_SELECTION_FRAME_PACING)->selected);
+				}
 			}
 			break;
 		case BIND_UP: case BIND_ARROWUP:
@@ -369,10 +380,11 @@ void LoadMenus()
 
 	menu = new Menu();
 	menu->AddMenuItem(new MenuItem(centerX, centerY - 32 * 6, "DISPLAY:", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_RIGHT));
-	menu->AddMenuItem(new MenuItem(centerX - 32 * 5, centerY - 32 * 3, "MODE:", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_RIGHT));
-	menu->AddMenuItem(new MenuItem(centerX, centerY, "FULLSCREEN:", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_RIGHT));
-	menu->AddMenuItem(new MenuItem(centerX, centerY + 32 * 3, "SCALING:", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_RIGHT));
-	menu->AddMenuItem(new MenuItem(centerX, centerY + 32 * 6, "BACK", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_CENTER));
+	menu->AddMenuItem(new MenuItem(centerX - 32 * 5, centerY - 32 * 4, "MODE:", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_RIGHT));
+	menu->AddMenuItem(new MenuItem(centerX, centerY - 32 * 2, "FULLSCREEN:", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_RIGHT));
+	menu->AddMenuItem(new MenuItem(centerX, centerY, "SCALING:", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_RIGHT));
+	menu->AddMenuItem(new MenuItem(centerX, centerY + 32 * 2, "FRAMES:", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_RIGHT));
+	menu->AddMenuItem(new MenuItem(centerX, centerY + 32 * 5, "BACK", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_CENTER));
 	menus[MENU_VIDEO_OPTIONS] = menu;
 
 	menu = new Menu();
@@ -403,19 +415,27 @@ void LoadMenus()
 	menus[MENU_SELECTION_DISPLAY_MODE] = menu;
 
 	menu = new Menu();
-	menu->AddMenuItem(new MenuItem(centerX + 32, centerY, "DISABLED", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
-	menu->AddMenuItem(new MenuItem(centerX + 32, centerY, "ENABLED", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
-	menu->AddMenuItem(new MenuItem(centerX + 32, centerY, "BORDERLESS", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
+	menu->AddMenuItem(new MenuItem(centerX + 32, centerY - 32 * 2, "DISABLED", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
+	menu->AddMenuItem(new MenuItem(centerX + 32, centerY - 32 * 2, "ENABLED", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
+	menu->AddMenuItem(new MenuItem(centerX + 32, centerY - 32 * 2, "BORDERLESS", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
 	menu->IsSwitchable = true;
 	menus[MENU_SELECTION_FULLSCREEN] = menu;
 
 	menu = new Menu();
-	menu->AddMenuItem(new MenuItem(centerX + 32, centerY + 32 * 3, "DEFAULT", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
-	menu->AddMenuItem(new MenuItem(centerX + 32, centerY + 32 * 3, "ADAPTIVE", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
-	menu->AddMenuItem(new MenuItem(centerX + 32, centerY + 32 * 3, "LETTERBOXED", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
+	menu->AddMenuItem(new MenuItem(centerX + 32, centerY, "DEFAULT", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
+	menu->AddMenuItem(new MenuItem(centerX + 32, centerY, "ADAPTIVE", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
+	menu->AddMenuItem(new MenuItem(centerX + 32, centerY, "LETTERBOXED", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
 	menu->IsSwitchable = true;
 	menus[MENU_SELECTION_SCALING_MODE] = menu;
 
+	menu = new Menu();
+	menu->AddMenuItem(new MenuItem(centerX + 32, centerY + 32 * 2, "VSYNC", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
+	menu->AddMenuItem(new MenuItem(centerX + 32, centerY + 32 * 2, "ADAPTIVE", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
+	menu->AddMenuItem(new MenuItem(centerX + 32, centerY + 32 * 2, "CAPPED " + std::to_string(FramePacing::GetFpsCap()), FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
+	menu->AddMenuItem(new MenuItem(centerX + 32, centerY + 32 * 2, "UNCAPPED", FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
+	menu->IsSwitchable = true;
+	menus[MENU_SELECTION_FRAME_PACING] = menu;
+
 	menu = new Menu();
 	menu->AddMenuItem(new MenuItem(centerX, centerY, "RETRY LEVEL", FONT_MENU, menu_color, selected_color));
 	menu->AddMenuItem(new MenuItem(centerX, centerY + 32 * 3, "NEW LEVEL", FONT_MENU, menu_color, selected_color));
@@ -562,7 +582,7 @@ int RefreshDisplayModeMenus()
 	{
 		std::ostringstream modeName;
 		modeName << mode.w << "x" << mode.h << "@" << mode.refresh_rate << "HZ " << SDL_BITSPERPIXEL(mode.format) << "-BIT";
-		menus.at(MENU_SELECTION_DISPLAY_MODE)->AddMenuItem(new MenuItem(Graphics::GetWindowNormalizedX(0.5) - 32 * 4, Graphics::GetWindowNormalizedY(0.5) - 32 * 3, modeName.str(), FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
+		menus.at(MENU_SELECTION_DISPLAY_MODE)->AddMenuItem(new MenuItem(Graphics::GetWindowNormalizedX(0.5) - 32 * 4, Graphics::GetWindowNormalizedY(0.5) - 32 * 4, modeName.str(), FONT_MENU, menu_color, selected_color, TEXT_ALIGN_LEFT));
 		
 		if(currentMode.w == mode.w &&
 			currentMode.h == mode.h &&
@@ -573,6 +593,7 @@ int RefreshDisplayModeMenus()
 
 	menus.at(MENU_SELECTION_FULLSCREEN)->selected = Graphics::GetFullscreenMode();
 	menus.at(MENU_SELECTION_SCALING_MODE)->selected = Graphics::GetScalingMode();
+	menus.at(MENU_SELECTION_FRAME_PACING)->selected = FramePacing::GetMode();
 	menus.at(MENU_SELECTION_DISPLAY)->selected = Graphics::GetDisplayIndex();
 	return 0;
 }
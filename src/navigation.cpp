@@ -0,0 +1,584 @@
+#include "navigation.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <map>
+#include <queue>
+#include <unordered_map>
+#include "ai.h"
+#include "entities.h"
+#include "level.h"
+#include "physics.h"
+#include "replay.h"
+#include "tiles.h"
+#include "utils.h"
+
+extern std::vector<std::vector<int>> tiles;
+extern std::vector<Creature*> creatures;
+extern std::map<std::string, CreatureData> creatureData;
+extern std::map<std::string, EntityGraphicsData> entityGraphicsData;
+
+namespace Navigation
+{
+	// Jump values the physics use, see JumpingState and ApplyForces
+	double const JUMP_VELOCITY = -1.75;
+	double const JUMP_ACCEL = -0.05; // what Creature sets jump_accel to
+	double const JUMP_TIME = 14;
+	double const GRAVITY = 0.15;
+	// how much lower than the take-off a jump may land
+	int const MAX_JUMP_DROP = 6;
+	// jumps are riskier than walking, so paths prefer walking when it's not much longer
+	int const JUMP_COST = 2;
+	// nodes a search may expand in one frame, see FindPath
+	int const SEARCH_BUDGET = 2000;
+	int const MAX_CACHED_PATHS = 512;
+	// how far below a creature to look for ground it will land on, in tiles
+	int const MAX_LANDING_DROP = 8;
+
+	typedef std::pair<int, int> OpenNode; // cost, node
+	typedef std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode>> OpenQueue;
+
+	// Best move towards the flow target from every node
+	struct FlowField
+	{
+		bool stale = true; // the graph changed since the steps were made
+		int target = -1;
+		std::vector<NavStep> steps; // node -1 where the target can't be reached
+		// the next field, made a search budget at a time
+		bool building = false;
+		int nextTarget = -1;
+		std::vector<int> distances;
+		std::vector<NavStep> nextSteps;
+		OpenQueue open;
+	};
+
+	struct ProfileEdges
+	{
+		NavProfile profile;
+		std::vector<std::vector<NavEdge>> edges; // by node
+		std::vector<std::vector<NavEdge>> incoming; // by node, "to" is where the edge comes from
+		FlowField flow;
+	};
+
+	struct CachedPath
+	{
+		NAV_RESULTS result;
+		NavPath path;
+	};
+
+	int width = 0;
+	int height = 0;
+	std::vector<NavNode> nodes;
+	std::vector<int> nodeAt; // by tile, column-major, -1 for no node
+	std::vector<ProfileEdges> profiles;
+
+	std::unordered_map<Uint64, CachedPath> cache;
+	int searchBudget = SEARCH_BUDGET;
+	int flowTarget = -1;
+
+	// search state, reused between searches. A node is only valid for the
+	// current search when its stamp matches
+	std::vector<int> costs;
+	std::vector<int> cameFrom;
+	std::vector<NAV_MOVES> cameBy;
+	std::vector<int> stamps;
+	int searchStamp = 0;
+
+	bool IsFree(int x, int y)
+	{
+		PHYSICS_TYPES type = GetTileTypeAtTiledPos(x, y);
+		return type != PHYSICS_OB && !IsSolid(type);
+	}
+
+	bool IsGround(int x, int y)
+	{
+		PHYSICS_TYPES type = GetTileTypeAtTiledPos(x, y);
+		if(type == PHYSICS_SPIKES)
+			return false;
+		return IsSolid(type) || type == PHYSICS_PLATFORM || type == PHYSICS_HOOK_PLATFORM;
+	}
+
+	// Whether tiles from top to bottom of a column are all free
+	bool IsColumnFree(int x, int top, int bottom)
+	{
+		for(int y = top; y <= bottom; y++)
+		{
+			if(!IsFree(x, y))
+				return false;
+		}
+		return true;
+	}
+
+	bool HasRoom(int node, int creatureHeight)
+	{
+		return IsColumnFree(nodes[node].x, nodes[node].y - creatureHeight + 1, nodes[node].y);
+	}
+
+	int GetNodeAt(int x, int y)
+	{
+		if(x < 0 || x >= width || y < 0 || y >= height)
+			return -1;
+		return nodeAt[x * height + y];
+	}
+
+	// Conservative: the creature has to pass a tile above the higher end
+	bool IsJumpClear(NavNode from, NavNode to, NavProfile &profile)
+	{
+		int dx = abs(to.x - from.x);
+		int over = std::min(from.y, to.y) - (dx > 1 ? 1 : 0);
+		if(from.y - over > profile.jumpHeight)
+			return false;
+		int top = over - profile.height + 1;
+		int step = to.x > from.x ? 1 : -1;
+		for(int x = from.x; x != to.x + step; x += step)
+		{
+			int bottom = x == from.x ? from.y : (x == to.x ? to.y : over);
+			if(!IsColumnFree(x, top, bottom))
+				return false;
+		}
+		return true;
+	}
+
+	void AddEdges(ProfileEdges &p, int node)
+	{
+		NavProfile &profile = p.profile;
+		std::vector<NavEdge> &edges = p.edges[node];
+		if(!HasRoom(node, profile.height))
+			return;
+		NavNode from = nodes[node];
+
+		for(int dir = -1; dir <= 1; dir += 2)
+		{
+			int x = from.x + dir;
+			if(!IsColumnFree(x, from.y - profile.height + 1, from.y))
+				continue;
+			int next = GetNodeAt(x, from.y);
+			if(next >= 0)
+			{
+				if(HasRoom(next, profile.height))
+					edges.push_back({ next, NAV_MOVE_WALK, 1 });
+				continue;
+			}
+			// walking off a ledge, falls until something is below
+			for(int y = from.y + 1; IsFree(x, y); y++)
+			{
+				next = GetNodeAt(x, y);
+				if(next >= 0)
+				{
+					edges.push_back({ next, NAV_MOVE_DROP, 1 + y - from.y });
+					break;
+				}
+			}
+		}
+
+		for(int dx = -profile.jumpDistance; dx <= profile.jumpDistance; dx++)
+		{
+			if(dx == 0)
+				continue;
+			for(int y = from.y - profile.jumpHeight; y <= from.y + MAX_JUMP_DROP; y++)
+			{
+				// that's just walking
+				if(y == from.y && abs(dx) == 1)
+					continue;
+				int next = GetNodeAt(from.x + dx, y);
+				if(next < 0 || !HasRoom(next, profile.height))
+					continue;
+				if(IsJumpClear(from, nodes[next], profile))
+					edges.push_back({ next, NAV_MOVE_JUMP, abs(dx) + abs(y - from.y) + JUMP_COST });
+			}
+		}
+	}
+
+	int GetProfileID(NavProfile profile)
+	{
+		for(int i = 0; i < (int)profiles.size(); i++)
+		{
+			if(profiles[i].profile == profile)
+				return i;
+		}
+		ProfileEdges p;
+		p.profile = profile;
+		p.edges.resize(nodes.size());
+		p.incoming.resize(nodes.size());
+		int edgeCount = 0;
+		for(int i = 0; i < (int)nodes.size(); i++)
+		{
+			AddEdges(p, i);
+			edgeCount += (int)p.edges[i].size();
+			for(auto &e : p.edges[i])
+				p.incoming[e.to].push_back({ i, e.move, e.cost });
+		}
+		profiles.push_back(p);
+		PrintLog(LOG_DEBUG, "Navigation: %i edges for height %i, jumps %i up and %i across", edgeCount, profile.height, profile.jumpHeight, profile.jumpDistance);
+		return (int)profiles.size() - 1;
+	}
+
+	// Follows a jump started at full walking speed the way the physics would
+	NavProfile MakeProfile(int hitboxHeight, double jumpAccel, double gravityMultiplier, double termVel, double moveVel)
+	{
+		double velY = JUMP_VELOCITY;
+		double y = 0, x = 0, peak = 0;
+		double jumpTime = JUMP_TIME;
+		for(int tick = 0; tick < 1000; tick++)
+		{
+			velY += jumpTime > 0 ? jumpAccel : GRAVITY * gravityMultiplier;
+			velY = std::min(velY, fabs(termVel));
+			jumpTime--;
+			y += velY;
+			x += fabs(moveVel);
+			peak = std::min(peak, y);
+			if(y >= 0 && velY > 0)
+				break;
+		}
+		NavProfile profile;
+		profile.height = std::max(1, (int)ceil(hitboxHeight / (double)TILESIZE));
+		profile.jumpHeight = (int)(-peak / TILESIZE);
+		profile.jumpDistance = (int)(x / TILESIZE);
+		return profile;
+	}
+
+	NavProfile GetProfile(Creature &c)
+	{
+		return MakeProfile(c.hitbox->GetRect().h, c.jump_accel, c.gravityMultiplier, c.term_vel, c.move_vel);
+	}
+
+	// The profile a creature of this type starts with, from the same data its constructor uses
+	NavProfile GetProfile(const std::string &creatureType)
+	{
+		auto data = creatureData.find(creatureType);
+		if(data == creatureData.end())
+			return NavProfile();
+		Hitbox &hitbox = entityGraphicsData[data->second.graphicsName].hitbox;
+		return MakeProfile(hitbox.GetRect().h, JUMP_ACCEL, data->second.gravityMultiplier, data->second.term_vel, data->second.move_vel);
+	}
+
+	// Nodes are numbered in the order of the collision grid, so the same
+	// collision always gives the same numbers. Paths in save states rely on that
+	void BuildNodes()
+	{
+		nodes.clear();
+		width = (int)tiles.size();
+		height = width ? (int)tiles[0].size() : 0;
+		nodeAt.assign(width * height, -1);
+		for(int x = 0; x < width; x++)
+		{
+			for(int y = 0; y < height - 1; y++)
+			{
+				if(IsFree(x, y) && IsGround(x, y + 1))
+				{
+					nodeAt[x * height + y] = (int)nodes.size();
+					nodes.push_back({ x, y });
+				}
+			}
+		}
+		costs.resize(nodes.size());
+		cameFrom.resize(nodes.size());
+		cameBy.resize(nodes.size());
+		stamps.assign(nodes.size(), 0);
+	}
+
+	void Build(const std::vector<std::string> &creatureTypes)
+	{
+		Cleanup();
+		BuildNodes();
+		PrintLog(LOG_INFO, "Navigation: %i nodes", (int)nodes.size());
+
+		// edges of the creatures the level will spawn are built now rather than in the middle of a game frame
+		for(auto &type : creatureTypes)
+			GetProfileID(GetProfile(type));
+	}
+
+	void Cleanup()
+	{
+		nodes.clear();
+		nodeAt.clear();
+		profiles.clear();
+		cache.clear();
+		flowTarget = -1;
+		width = height = 0;
+	}
+
+	// Updates the graph after a tile was removed during play. Only nodes close
+	// enough to walk, drop or jump past the tile get their edges built again,
+	// the rest keep theirs with the nodes renumbered. Cached paths, flow fields
+	// and the paths creatures are following are dropped
+	void OnTileChanged(int x, int y)
+	{
+		if(nodeAt.empty())
+			return;
+		std::vector<NavNode> oldNodes;
+		oldNodes.swap(nodes);
+		BuildNodes();
+		std::vector<int> renumbered(oldNodes.size());
+		for(int i = 0; i < (int)oldNodes.size(); i++)
+			renumbered[i] = GetNodeAt(oldNodes[i].x, oldNodes[i].y);
+
+		for(auto &p : profiles)
+		{
+			int reach = std::max(1, p.profile.jumpDistance);
+			std::vector<std::vector<NavEdge>> edges(nodes.size());
+			for(int i = 0; i < (int)oldNodes.size(); i++)
+			{
+				int node = renumbered[i];
+				if(node < 0 || abs(oldNodes[i].x - x) <= reach)
+					continue;
+				for(auto e : p.edges[i])
+				{
+					e.to = renumbered[e.to];
+					if(e.to >= 0)
+						edges[node].push_back(e);
+				}
+			}
+			p.edges.swap(edges);
+			p.incoming.assign(nodes.size(), std::vector<NavEdge>());
+			for(int i = 0; i < (int)nodes.size(); i++)
+			{
+				if(abs(nodes[i].x - x) <= reach)
+					AddEdges(p, i);
+				for(auto &e : p.edges[i])
+					p.incoming[e.to].push_back({ i, e.move, e.cost });
+			}
+			p.flow.stale = true;
+			p.flow.building = false;
+		}
+
+		cache.clear();
+		flowTarget = flowTarget >= 0 ? renumbered[flowTarget] : -1;
+		for(auto &c : creatures)
+		{
+			if(c->AI)
+				c->AI->ForgetPath();
+		}
+		PrintLog(LOG_DEBUG, "Navigation: tile %i,%i changed, %i nodes", x, y, (int)nodes.size());
+	}
+
+	void BeginFrame()
+	{
+		// which searches get deferred depends on what's cached, and a replay
+		// seeking from a keyframe starts with nothing cached
+		if(Replay::IsPlaying() || Replay::IsRecording())
+			searchBudget = INT_MAX;
+		else
+			searchBudget = SEARCH_BUDGET;
+	}
+
+	int GetNodeCount()
+	{
+		return (int)nodes.size();
+	}
+
+	NavNode GetNode(int node)
+	{
+		return nodes[node];
+	}
+
+	// Node the creature stands on, -1 when it's in the air
+	int FindStandingNode(Creature &c)
+	{
+		SDL_Rect rect = c.hitbox->GetRect();
+		int x = (int)floor((c.GetX() + rect.w / 2) / TILESIZE);
+		int y = (int)floor((c.GetY() - 1) / TILESIZE);
+		return GetNodeAt(x, y);
+	}
+
+	// Node the creature stands on or will land on when falling straight down
+	int FindNodeBelow(Creature &c)
+	{
+		SDL_Rect rect = c.hitbox->GetRect();
+		int x = (int)floor((c.GetX() + rect.w / 2) / TILESIZE);
+		int y = (int)floor((c.GetY() - 1) / TILESIZE);
+		for(int i = 0; i <= MAX_LANDING_DROP && IsFree(x, y + i); i++)
+		{
+			int node = GetNodeAt(x, y + i);
+			if(node >= 0)
+				return node;
+		}
+		return -1;
+	}
+
+	const std::vector<NavEdge>& GetEdges(int profileID, int node)
+	{
+		return profiles[profileID].edges[node];
+	}
+
+	int EstimateCost(int from, int to)
+	{
+		return abs(nodes[from].x - nodes[to].x) + abs(nodes[from].y - nodes[to].y);
+	}
+
+	// A*. Searches share a budget of expanded nodes per frame: once it's spent,
+	// further searches are deferred to the next frame. The first search of a
+	// frame always runs to the end, so long paths still get found
+	NAV_RESULTS Search(int profileID, int from, int to, NavPath &path)
+	{
+		if(searchBudget <= 0)
+			return NAV_DEFERRED;
+		int limit = searchBudget == SEARCH_BUDGET ? INT_MAX : searchBudget;
+
+		searchStamp++;
+		OpenQueue open; // by estimated total cost
+		costs[from] = 0;
+		cameFrom[from] = -1;
+		cameBy[from] = NAV_MOVE_WALK;
+		stamps[from] = searchStamp;
+		open.push({ EstimateCost(from, to), from });
+
+		int expanded = 0;
+		NAV_RESULTS result = NAV_NOT_FOUND;
+		while(!open.empty())
+		{
+			OpenNode current = open.top();
+			open.pop();
+			int node = current.second;
+			// a cheaper way here was found after this entry was queued
+			if(current.first - EstimateCost(node, to) > costs[node])
+				continue;
+			if(node == to)
+			{
+				result = NAV_FOUND;
+				break;
+			}
+			if(++expanded > limit)
+			{
+				result = NAV_DEFERRED;
+				break;
+			}
+			for(auto &e : profiles[profileID].edges[node])
+			{
+				int cost = costs[node] + e.cost;
+				if(stamps[e.to] == searchStamp && costs[e.to] <= cost)
+					continue;
+				stamps[e.to] = searchStamp;
+				costs[e.to] = cost;
+				cameFrom[e.to] = node;
+				cameBy[e.to] = e.move;
+				open.push({ cost + EstimateCost(e.to, to), e.to });
+			}
+		}
+		searchBudget = std::max(0, searchBudget - expanded);
+
+		path.clear();
+		if(result != NAV_FOUND)
+			return result;
+		for(int node = to; node >= 0; node = cameFrom[node])
+			path.push_back({ node, cameBy[node] });
+		std::reverse(path.begin(), path.end());
+		return NAV_FOUND;
+	}
+
+	// Finds the cheapest path between two nodes. Results are cached until
+	// the graph changes
+	NAV_RESULTS FindPath(int profileID, int from, int to, NavPath &path)
+	{
+		if(from < 0 || to < 0 || profileID < 0 || profileID >= (int)profiles.size())
+			return NAV_NOT_FOUND;
+		Uint64 key = ((Uint64)profileID << 48) | ((Uint64)from << 24) | (Uint64)to;
+		auto cached = cache.find(key);
+		if(cached != cache.end())
+		{
+			path = cached->second.path;
+			return cached->second.result;
+		}
+
+		NAV_RESULTS result = Search(profileID, from, to, path);
+		if(result == NAV_DEFERRED)
+			return result;
+		if((int)cache.size() >= MAX_CACHED_PATHS)
+			cache.clear();
+		cache[key] = { result, path };
+		return result;
+	}
+
+	// Dijkstra from the target over the edges reversed
+	void StartFlowField(ProfileEdges &p)
+	{
+		FlowField &flow = p.flow;
+		flow.building = true;
+		flow.nextTarget = flowTarget;
+		flow.distances.assign(nodes.size(), INT_MAX);
+		flow.nextSteps.assign(nodes.size(), { -1, NAV_MOVE_WALK });
+		flow.open = OpenQueue();
+		if(flowTarget < 0)
+			return;
+		flow.distances[flowTarget] = 0;
+		flow.open.push({ 0, flowTarget });
+	}
+
+	// Goes on with the next field until it's done or the search budget is spent,
+	// then puts it in place of the old one
+	void ContinueFlowField(ProfileEdges &p)
+	{
+		FlowField &flow = p.flow;
+		int expanded = 0;
+		while(!flow.open.empty() && expanded < searchBudget)
+		{
+			OpenNode current = flow.open.top();
+			flow.open.pop();
+			int node = current.second;
+			if(current.first > flow.distances[node])
+				continue;
+			expanded++;
+			for(auto &e : p.incoming[node])
+			{
+				int distance = current.first + e.cost;
+				if(distance >= flow.distances[e.to])
+					continue;
+				flow.distances[e.to] = distance;
+				flow.nextSteps[e.to] = { node, e.move };
+				flow.open.push({ distance, e.to });
+			}
+		}
+		searchBudget = std::max(0, searchBudget - expanded);
+		if(!flow.open.empty())
+			return;
+		flow.building = false;
+		flow.stale = false;
+		flow.target = flow.nextTarget;
+		flow.steps.swap(flow.nextSteps);
+		flow.distances.clear();
+	}
+
+	// Every enemy chasing the same target shares its flow field. It only
+	// changes when the target gets to another node, and stays where it was
+	// while the target is in the air
+	void SetFlowTarget(Creature &target)
+	{
+		int node = FindNodeBelow(target);
+		if(node >= 0)
+			flowTarget = node;
+	}
+
+	int GetFlowTarget()
+	{
+		return flowTarget;
+	}
+
+	// Puts back a target saved with GetFlowTarget
+	void RestoreFlowTarget(int node)
+	{
+		flowTarget = node >= 0 && node < (int)nodes.size() ? node : -1;
+	}
+
+	// Next move towards the flow target, NAV_NOT_FOUND when already there or
+	// it can't be reached. A new field is made with the search budget over as
+	// many frames as it takes. The old one still leads to where the target
+	// was meanwhile, unless the graph changed, then it's NAV_DEFERRED
+	NAV_RESULTS GetFlowStep(int profileID, int node, NavStep &step)
+	{
+		if(node < 0 || profileID < 0 || profileID >= (int)profiles.size())
+			return NAV_NOT_FOUND;
+		FlowField &flow = profiles[profileID].flow;
+		// fields of profiles nobody asks for are left alone. One being made
+		// is finished first, even if the target moved on since
+		if(!flow.building && (flow.stale || flow.target != flowTarget))
+			StartFlowField(profiles[profileID]);
+		if(flow.building)
+			ContinueFlowField(profiles[profileID]);
+		if(flow.stale)
+			return NAV_DEFERRED;
+		if(flow.steps[node].node < 0)
+			return NAV_NOT_FOUND;
+		step = flow.steps[node];
+		return NAV_FOUND;
+	}
+}
@@ -0,0 +1,85 @@
+#ifndef _navigation_h_
+#define _navigation_h_
+
+#include <SDL.h>
+#include <string>
+#include <vector>
+
+class Creature;
+
+enum NAV_MOVES
+{
+	NAV_MOVE_WALK,
+	NAV_MOVE_DROP, // walking off a ledge
+	NAV_MOVE_JUMP
+};
+
+// What a creature can get over, in tiles
+struct NavProfile
+{
+	int height = 1;
+	int jumpHeight = 0;
+	int jumpDistance = 0;
+	bool operator==(const NavProfile &other) const
+	{
+		return height == other.height && jumpHeight == other.jumpHeight && jumpDistance == other.jumpDistance;
+	}
+};
+
+// A tile right above the ground, where feet of a standing creature end up
+struct NavNode
+{
+	int x;
+	int y;
+};
+
+struct NavEdge
+{
+	int to;
+	NAV_MOVES move;
+	int cost;
+};
+
+// A node of a path and the move that gets there
+struct NavStep
+{
+	int node;
+	NAV_MOVES move;
+};
+
+typedef std::vector<NavStep> NavPath;
+
+enum NAV_RESULTS
+{
+	NAV_FOUND,
+	NAV_NOT_FOUND,
+	NAV_DEFERRED // out of search budget for this frame, ask again later
+};
+
+// Navigation graph of the level surfaces, built from the collision grid when
+// the level is loaded and updated when tiles are removed during play.
+// Nodes are shared, edges are built for each movement profile since jumps
+// depend on how high and far a creature can get.
+namespace Navigation
+{
+	void Build(const std::vector<std::string> &creatureTypes);
+	void Cleanup();
+	void OnTileChanged(int x, int y);
+	void BeginFrame();
+	NavProfile GetProfile(Creature &c);
+	NavProfile GetProfile(const std::string &creatureType);
+	int GetProfileID(NavProfile profile);
+	int GetNodeCount();
+	NavNode GetNode(int node);
+	int GetNodeAt(int x, int y);
+	int FindStandingNode(Creature &c);
+	int FindNodeBelow(Creature &c);
+	const std::vector<NavEdge>& GetEdges(int profileID, int node);
+	NAV_RESULTS FindPath(int profileID, int from, int to, NavPath &path);
+	void SetFlowTarget(Creature &target);
+	int GetFlowTarget();
+	void RestoreFlowTarget(int node);
+	NAV_RESULTS GetFlowStep(int profileID, int node, NavStep &step);
+}
+
+#endif
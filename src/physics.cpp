@@ -4,6 +4,7 @@
 #include "gamelogic.h"
 #include "graphics.h"
 #include "level.h"
+#include "lineofsight.h"
 #include "sound.h"
 #include "state.h"
 #include "tiles.h"
@@ -854,11 +855,11 @@ bool ApplyPhysics(Bullet &b, double ticks)
 				// TODO: Optimize this?
 				for(auto &layer : tileLayers)
 				{
-					if(layer.tiles[tileX][tileY] != nullptr)
+					if(layer.At(tileX, tileY) != nullptr)
 					{
-						if(layer.tiles[tileX][tileY]->type == PHYSICS_ICEBLOCK)
+						if(layer.At(tileX, tileY)->type == PHYSICS_ICEBLOCK)
 						{
-							delete layer.tiles[tileX][tileY];
+							RemoveTile(layer.At(tileX, tileY));
 							Effect * eff = new Effect(EFFECT_ICEMELT);
 							eff->SetPos(tileX * TILESIZE, (tileY + 1) * TILESIZE);
 						}
@@ -920,7 +921,8 @@ bool ApplyPhysics(Lightning &l, double ticks)
 	{
 		if(j == nullptr)
 			continue;
-		if(l.hitbox->HasCollision(j->hitbox))
+		// the bolt is cut off by walls, but its hitbox is tall enough to reach around corners
+		if(l.hitbox->HasCollision(j->hitbox) && LineOfSight::IsClear(l.origin, LineOfSight::GetCenter(*j)))
 			j->TakeDamage(100);
 	}
 
@@ -1380,12 +1382,12 @@ Bullet* PickBlock(Creature *cr, DIRECTIONS dir)
 				{
 					for(auto &layer : tileLayers)
 					{
-						Tile *tile = layer.tiles[x][y];
+						Tile *tile = layer.At(x, y);
 						if(tile != nullptr)
 						{
 							if(tile->type == PHYSICS_ICEBLOCK)
 							{
-								delete tile;
+								RemoveTile(tile);
 							}
 						}
 					}
@@ -0,0 +1,235 @@
+#include "preloader.h"
+#include <SDL.h>
+#include <SDL_image.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "INIReader.h"
+#include "graphics.h"
+#include "sound.h"
+#include "utils.h"
+
+extern TextureManager textureManager;
+
+namespace Preloader
+{
+	enum PRELOAD_TYPES
+	{
+		PRELOAD_TEXTURE,
+		PRELOAD_SOUND,
+		PRELOAD_MUSIC
+	};
+
+	struct PreloadJob
+	{
+		PRELOAD_TYPES type;
+		std::string name;
+		std::string file;
+		// results, filled by a worker thread
+		SDL_Surface *surface = NULL;
+		Mix_Chunk *chunk = NULL;
+		std::vector<char> data;
+		// SDL errors are kept per thread, so the worker's is copied here
+		std::string error;
+	};
+
+	int const MAX_WORKERS = 4;
+
+	// not resized while workers are running
+	std::vector<PreloadJob> jobs;
+	std::atomic<int> nextJob{ 0 };
+	std::atomic<bool> cancelled{ false };
+
+	// indices of decoded jobs waiting to be uploaded
+	std::vector<int> finished;
+	std::mutex finishedMutex;
+
+	std::vector<std::thread> workers;
+	int uploaded = 0;
+	Uint32 startTime = 0;
+
+	void Decode(PreloadJob &job)
+	{
+		switch(job.type)
+		{
+			case PRELOAD_TEXTURE:
+				job.surface = IMG_Load(job.file.c_str());
+				if(!job.surface)
+					job.error = IMG_GetError();
+				break;
+			case PRELOAD_SOUND:
+				job.chunk = Mix_LoadWAV(job.file.c_str());
+				if(!job.chunk)
+					job.error = Mix_GetError();
+				break;
+			case PRELOAD_MUSIC:
+				// streamed by the mixer while playing, so only the file read is done here
+				if(!ReadFileData(job.file, job.data))
+					job.error = SDL_GetError();
+				break;
+		}
+	}
+
+	void WorkerThread()
+	{
+		while(!cancelled)
+		{
+			int i = nextJob++;
+			if(i >= (int)jobs.size())
+				break;
+			Decode(jobs[i]);
+			std::lock_guard<std::mutex> lock(finishedMutex);
+			finished.push_back(i);
+		}
+	}
+
+	void AddJobs(INIReader &reader, std::string section, PRELOAD_TYPES type)
+	{
+		std::vector<std::string> names;
+		tokenize(reader.Get(section, "Files", ""), names, ", ", true);
+		for(auto &i : names)
+		{
+			PreloadJob job;
+			job.type = type;
+			job.name = i;
+			switch(type)
+			{
+				case PRELOAD_TEXTURE:
+					// already on the GPU, nothing to do
+					if(textureManager.IsLoaded(i))
+						continue;
+					job.file = i;
+					break;
+				case PRELOAD_SOUND:
+					job.file = Sound::GetSfxFile(i);
+					break;
+				case PRELOAD_MUSIC:
+					job.file = Sound::GetMusicFile(i);
+					break;
+			}
+			jobs.push_back(job);
+		}
+	}
+
+	void Start(std::string manifest)
+	{
+		Cleanup();
+
+		INIReader reader(manifest);
+		if(reader.ParseError() < 0)
+		{
+			PrintLog(LOG_IMPORTANT, "Can't load preload manifest %s", manifest.c_str());
+			return;
+		}
+		AddJobs(reader, "Textures", PRELOAD_TEXTURE);
+		AddJobs(reader, "Sounds", PRELOAD_SOUND);
+		AddJobs(reader, "Music", PRELOAD_MUSIC);
+		if(jobs.empty())
+			return;
+
+		startTime = SDL_GetTicks();
+		// leave one core for the game itself
+		int workerCount = std::min({ MAX_WORKERS, std::max(1, SDL_GetCPUCount() - 1), (int)jobs.size() });
+		for(int i = 0; i < workerCount; i++)
+			workers.push_back(std::thread(WorkerThread));
+		PrintLog(LOG_INFO, "Preloading %i assets on %i threads", (int)jobs.size(), workerCount);
+	}
+
+	void Upload(PreloadJob &job)
+	{
+		switch(job.type)
+		{
+			case PRELOAD_TEXTURE:
+				if(!job.surface)
+				{
+					PrintLog(LOG_IMPORTANT, "Couldn't preload %s: %s", job.file.c_str(), job.error.c_str());
+					break;
+				}
+				if(!textureManager.IsLoaded(job.file))
+					textureManager.AddTexture(job.file, SDL_CreateTextureFromSurface(Graphics::GetRenderer(), job.surface));
+				SDL_FreeSurface(job.surface);
+				job.surface = NULL;
+				break;
+			case PRELOAD_SOUND:
+				if(!job.chunk)
+				{
+					PrintLog(LOG_IMPORTANT, "Couldn't preload %s: %s", job.file.c_str(), job.error.c_str());
+					break;
+				}
+				Sound::AddSfx(job.name, job.chunk);
+				job.chunk = NULL;
+				break;
+			case PRELOAD_MUSIC:
+				if(job.data.empty())
+				{
+					PrintLog(LOG_IMPORTANT, "Couldn't preload %s: %s", job.file.c_str(), job.error.c_str());
+					break;
+				}
+				Sound::AddMusicData(job.name, job.data);
+				break;
+		}
+	}
+
+	// Uploads everything the workers have decoded since the last call
+	void Update()
+	{
+		if(IsDone())
+			return;
+
+		std::vector<int> ready;
+		{
+			std::lock_guard<std::mutex> lock(finishedMutex);
+			ready.swap(finished);
+		}
+		for(auto i : ready)
+			Upload(jobs[i]);
+		uploaded += (int)ready.size();
+		// loading progress is shown on screen
+		if(!ready.empty())
+			Graphics::RequestRedraw();
+
+		if(uploaded == (int)jobs.size())
+		{
+			for(auto &i : workers)
+				i.join();
+			workers.clear();
+			PrintLog(LOG_INFO, "Preloaded %i assets in %i ms", uploaded, SDL_GetTicks() - startTime);
+		}
+	}
+
+	bool IsDone()
+	{
+		return uploaded == (int)jobs.size();
+	}
+
+	double GetProgress()
+	{
+		if(jobs.empty())
+			return 1;
+		return uploaded / (double)jobs.size();
+	}
+
+	void Cleanup()
+	{
+		cancelled = true;
+		for(auto &i : workers)
+			i.join();
+		workers.clear();
+
+		// decoded but never handed over
+		for(auto &i : jobs)
+		{
+			if(i.surface)
+				SDL_FreeSurface(i.surface);
+			if(i.chunk)
+				Mix_FreeChunk(i.chunk);
+		}
+		std::vector<PreloadJob>().swap(jobs);
+		finished.clear();
+		nextJob = 0;
+		uploaded = 0;
+		cancelled = false;
+	}
+}
@@ -0,0 +1,21 @@
+#ifndef _preloader_h_
+#define _preloader_h_
+
+#include <string>
+
+// Decodes assets listed in a manifest on background threads.
+// Results are handed to the texture manager and the sound system in Update,
+// which has to be called from the main (rendering) thread.
+// It runs once, behind the title screen. Levels are picked from the map
+// select menu, so there's no next level known during a transition, and
+// nothing loaded is freed when a level ends.
+namespace Preloader
+{
+	void Start(std::string manifest);
+	void Update();
+	bool IsDone();
+	double GetProgress();
+	void Cleanup();
+}
+
+#endif
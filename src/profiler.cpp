@@ -0,0 +1,106 @@
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+#include "globals.h"
+#include "utils.h"
+
+namespace Profiler
+{
+	int const PROFILER_HISTORY_SIZE = 240;
+
+	struct StatHistory
+	{
+		double samples[PROFILER_HISTORY_SIZE];
+		int next = 0;
+		int count = 0;
+	};
+
+	StatHistory history[PROFILE_COUNT];
+
+	const char* statNames[PROFILE_COUNT] = {
+		"frame",
+		"present (default)",
+		"present (adaptive)",
+		"present (letterboxed)",
+		"simulation",
+		"scene",
+		"tiles",
+		"draw",
+		"ai",
+		"ai deferred"
+	};
+
+	Uint64 GetTime()
+	{
+		return SDL_GetPerformanceCounter();
+	}
+
+	double GetElapsedMs(Uint64 from)
+	{
+		return (SDL_GetPerformanceCounter() - from) * 1000.0 / SDL_GetPerformanceFrequency();
+	}
+
+	void AddSample(PROFILER_STATS stat, double ms)
+	{
+		StatHistory &h = history[stat];
+		h.samples[h.next] = ms;
+		h.next = (h.next + 1) % PROFILER_HISTORY_SIZE;
+		h.count = std::min(h.count + 1, PROFILER_HISTORY_SIZE);
+	}
+
+	ProfilerStat GetStat(PROFILER_STATS stat)
+	{
+		ProfilerStat result;
+		StatHistory &h = history[stat];
+		if(!h.count)
+			return result;
+
+		result.samples = h.count;
+		result.last = h.samples[(h.next + PROFILER_HISTORY_SIZE - 1) % PROFILER_HISTORY_SIZE];
+		result.min = result.max = result.last;
+		double sum = 0;
+		for(int i = 0; i < h.count; i++)
+		{
+			sum += h.samples[i];
+			result.min = std::min(result.min, h.samples[i]);
+			result.max = std::max(result.max, h.samples[i]);
+		}
+		result.average = sum / h.count;
+		double variance = 0;
+		for(int i = 0; i < h.count; i++)
+			variance += (h.samples[i] - result.average) * (h.samples[i] - result.average);
+		result.jitter = sqrt(variance / h.count);
+		return result;
+	}
+
+	const char* GetStatName(PROFILER_STATS stat)
+	{
+		return statNames[stat];
+	}
+
+	void Report()
+	{
+		for(int i = 0; i < PROFILE_COUNT; i++)
+		{
+			ProfilerStat s = GetStat((PROFILER_STATS)i);
+			if(!s.samples)
+				continue;
+			if(i == PROFILE_AI_DEFERRED)
+			{
+				PrintLog(LOG_INFO, "%s: avg %.2f, max %.0f (%i samples)", statNames[i], s.average, s.max, s.samples);
+				continue;
+			}
+			PrintLog(LOG_INFO, "%s: avg %.3f ms, min %.3f, max %.3f, jitter %.3f (%i samples)",
+				statNames[i], s.average, s.min, s.max, s.jitter, s.samples);
+		}
+	}
+
+	void Reset()
+	{
+		for(auto &h : history)
+		{
+			h.next = 0;
+			h.count = 0;
+		}
+	}
+}
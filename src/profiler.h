@@ -0,0 +1,44 @@
+#ifndef _profiler_h_
+#define _profiler_h_
+
+#include <SDL.h>
+
+enum PROFILER_STATS
+{
+	PROFILE_FRAME, // whole main loop iteration
+	// putting the game scene on screen, one per scaling mode
+	PROFILE_PRESENT_DEFAULT,
+	PROFILE_PRESENT_ADAPTIVE,
+	PROFILE_PRESENT_LETTERBOXED,
+	PROFILE_SIMULATION, // game logic and physics
+	PROFILE_SCENE, // building and drawing the whole game scene
+	PROFILE_TILES, // queueing visible tiles
+	PROFILE_DRAW, // executing the render queue
+	PROFILE_AI, // thinking of all creatures
+	PROFILE_AI_DEFERRED, // count of thinkers put off to the next frame, not ms
+	PROFILE_COUNT
+};
+
+struct ProfilerStat
+{
+	double last = 0;
+	double average = 0;
+	double min = 0;
+	double max = 0;
+	double jitter = 0; // standard deviation
+	int samples = 0;
+};
+
+// Keeps the last few hundred samples (in ms, unless noted) of each measured stat
+namespace Profiler
+{
+	Uint64 GetTime();
+	double GetElapsedMs(Uint64 from);
+	void AddSample(PROFILER_STATS stat, double ms);
+	ProfilerStat GetStat(PROFILER_STATS stat);
+	const char* GetStatName(PROFILER_STATS stat);
+	void Report();
+	void Reset();
+}
+
+#endif
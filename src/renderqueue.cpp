@@ -0,0 +1,89 @@
+#include "renderqueue.h"
+#include <algorithm>
+
+void RenderQueue::AddCopy(RENDER_LAYERS layer, SDL_Texture *texture, const SDL_Rect &src, const SDL_Rect &dst, SDL_RendererFlip flip)
+{
+	if(texture == NULL)
+		return;
+	commands.push_back({ layer, texture, src, dst, flip, { 0, 0, 0, 0 }, 0, 0 });
+}
+
+void RenderQueue::AddFill(RENDER_LAYERS layer, SDL_Color color, const SDL_Rect &rect)
+{
+	commands.push_back({ layer, NULL, { 0, 0, 0, 0 }, rect, SDL_FLIP_NONE, color, (int)fillRects.size(), 1 });
+	fillRects.push_back(rect);
+}
+
+// One command for any number of rects, like the pixels of a lightning bolt
+void RenderQueue::AddFills(RENDER_LAYERS layer, SDL_Color color, const std::vector<SDL_Rect> &rects)
+{
+	if(rects.empty())
+		return;
+	commands.push_back({ layer, NULL, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, SDL_FLIP_NONE, color, (int)fillRects.size(), (int)rects.size() });
+	fillRects.insert(fillRects.end(), rects.begin(), rects.end());
+}
+
+void RenderQueue::FlushFills(SDL_Renderer *renderer)
+{
+	if(fillBatch.empty())
+		return;
+	SDL_RenderFillRects(renderer, fillBatch.data(), fillBatch.size());
+	fillBatch.clear();
+	stats.drawCalls++;
+}
+
+void RenderQueue::Execute(SDL_Renderer *renderer)
+{
+	// Stable, so things on the same layer keep the order they were added in
+	std::stable_sort(commands.begin(), commands.end(), [](const RenderCommand &a, const RenderCommand &b)
+	{
+		return a.layer < b.layer;
+	});
+
+	stats = RenderStats();
+	stats.commands = (int)commands.size();
+	SDL_Texture *lastTexture = NULL;
+	SDL_Color fillColor = { 0, 0, 0, 0 };
+	for(auto &c : commands)
+	{
+		if(c.texture == NULL)
+		{
+			// neighbouring fills of the same color go out as one call
+			if(!fillBatch.empty() && (c.color.r != fillColor.r || c.color.g != fillColor.g || c.color.b != fillColor.b || c.color.a != fillColor.a))
+				FlushFills(renderer);
+			if(fillBatch.empty())
+			{
+				fillColor = c.color;
+				SDL_SetRenderDrawColor(renderer, fillColor.r, fillColor.g, fillColor.b, fillColor.a);
+			}
+			fillBatch.insert(fillBatch.end(), fillRects.begin() + c.fillFirst, fillRects.begin() + c.fillFirst + c.fillCount);
+			continue;
+		}
+		FlushFills(renderer);
+		if(c.texture != lastTexture)
+		{
+			stats.textureSwitches++;
+			lastTexture = c.texture;
+		}
+		stats.drawCalls++;
+		if(c.flip == SDL_FLIP_NONE)
+			SDL_RenderCopy(renderer, c.texture, &c.src, &c.dst);
+		else
+			SDL_RenderCopyEx(renderer, c.texture, &c.src, &c.dst, 0, NULL, c.flip);
+	}
+	FlushFills(renderer);
+	commands.clear();
+	fillRects.clear();
+}
+
+RenderStats RenderQueue::GetStats()
+{
+	return stats;
+}
+
+void RenderQueue::Clear()
+{
+	std::vector<RenderCommand>().swap(commands);
+	std::vector<SDL_Rect>().swap(fillRects);
+	std::vector<SDL_Rect>().swap(fillBatch);
+}
@@ -0,0 +1,66 @@
+#ifndef _renderqueue_h_
+#define _renderqueue_h_
+
+#include <SDL.h>
+#include <vector>
+
+// Draw order of the game scene, bottom to top
+enum RENDER_LAYERS
+{
+	RENDER_LAYER_TILES,
+	RENDER_LAYER_MACHINERY,
+	RENDER_LAYER_PICKUPS,
+	RENDER_LAYER_CREATURES,
+	RENDER_LAYER_LIGHTNING,
+	RENDER_LAYER_PLAYER,
+	RENDER_LAYER_EFFECTS,
+	RENDER_LAYER_BULLETS,
+	RENDER_LAYER_DEBUG
+};
+
+// A texture copy, or filled rects of one color when there's no texture
+struct RenderCommand
+{
+	RENDER_LAYERS layer;
+	SDL_Texture *texture;
+	SDL_Rect src;
+	SDL_Rect dst;
+	SDL_RendererFlip flip;
+	SDL_Color color;
+	// fills, as a range of the queue's fill rects
+	int fillFirst;
+	int fillCount;
+};
+
+// What the last executed queue cost
+struct RenderStats
+{
+	int commands = 0;
+	int drawCalls = 0;
+	int textureSwitches = 0;
+};
+
+// Collects what the scene is made of while game state is read, then draws it
+// in one go sorted by layer. Within a layer things are drawn in the order they
+// were added, so overlapping sprites don't depend on texture addresses.
+// Sprites mostly come from the atlas, so neighbours share a texture anyway
+class RenderQueue
+{
+	private:
+		std::vector<RenderCommand> commands;
+		std::vector<SDL_Rect> fillRects;
+		std::vector<SDL_Rect> fillBatch;
+		RenderStats stats;
+
+		void FlushFills(SDL_Renderer *renderer);
+
+	public:
+		void AddCopy(RENDER_LAYERS layer, SDL_Texture *texture, const SDL_Rect &src, const SDL_Rect &dst, SDL_RendererFlip flip = SDL_FLIP_NONE);
+		void AddFill(RENDER_LAYERS layer, SDL_Color color, const SDL_Rect &rect);
+		void AddFills(RENDER_LAYERS layer, SDL_Color color, const std::vector<SDL_Rect> &rects);
+		void Execute(SDL_Renderer *renderer);
+		RenderStats GetStats();
+		void Clear();
+};
+
+#endif
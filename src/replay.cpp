@@ -0,0 +1,420 @@
+#include "replay.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include "framepacing.h"
+#include "gamelogic.h"
+#include "globals.h"
+#include "input.h"
+#include "profiler.h"
+#include "savestate.h"
+#include "utils.h"
+
+extern RandomGenerator entity_rg;
+extern RandomGenerator ai_rg;
+extern RandomGenerator level_rg;
+namespace Graphics
+{
+	extern RandomGenerator graphics_rg;
+}
+
+namespace Replay
+{
+	int const BIND_COUNT = BIND_ENTER + 1;
+	// game time between keyframes, unless -keyframes says otherwise
+	double const DEFAULT_KEYFRAME_INTERVAL = SecToTicks(10);
+
+	struct ReplayEvent
+	{
+		int bind;
+		bool pressed;
+	};
+
+	struct ReplayFrame
+	{
+		double ticks;
+		Uint32 held; // one bit per bind
+		std::vector<ReplayEvent> events;
+	};
+
+	// Save state taken while recording, right before the game update of its frame
+	struct Keyframe
+	{
+		int frame;
+		std::vector<char> data;
+	};
+
+	std::string recordFile;
+	std::ofstream out;
+	// keyframes go next to the replay, into <replay>.keys
+	std::ofstream keysOut;
+	bool recording = false;
+	// binds pressed or released since the last recorded frame
+	std::vector<ReplayEvent> pendingEvents;
+	double keyframeInterval = DEFAULT_KEYFRAME_INTERVAL;
+	double sinceKeyframe = 0;
+
+	std::vector<ReplayFrame> frames;
+	std::vector<Keyframe> keyframes;
+	bool playing = false;
+	int frame = 0;
+	std::string mapName;
+	// what IsBindPressed sees during playback, instead of the real devices
+	Uint32 heldBinds = 0;
+	// a keyframe is taken after the input of its frame was handled,
+	// so that input isn't fed again after loading one
+	bool inputApplied = false;
+
+	std::string playFile;
+	int seekFrame = 0;
+	bool fastForward = false;
+	Uint64 startTime = 0;
+
+	bool ParseArgs(int argc, char* argv[])
+	{
+		for(int i = 1; i < argc; i++)
+		{
+			if(strcmp(argv[i], "-fastforward") == 0)
+				fastForward = true;
+			if(i + 1 >= argc)
+				continue;
+			if(strcmp(argv[i], "-record") == 0)
+				recordFile = argv[i + 1];
+			else if(strcmp(argv[i], "-keyframes") == 0)
+				keyframeInterval = SecToTicks(std::max(1.0, atof(argv[i + 1])));
+			else if(strcmp(argv[i], "-play") == 0)
+				playFile = argv[i + 1];
+			else if(strcmp(argv[i], "-seek") == 0)
+				seekFrame = std::max(0, atoi(argv[i + 1]));
+		}
+		if(playFile.empty())
+			fastForward = false;
+		return !recordFile.empty() || !playFile.empty();
+	}
+
+	// Everything random starts over, so the level plays out the same
+	void ResetRandomGenerators()
+	{
+		entity_rg.ResetSequence();
+		ai_rg.ResetSequence();
+		level_rg.ResetSequence();
+		Graphics::graphics_rg.ResetSequence();
+	}
+
+	// Each keyframe is its frame number, size and save state. Replays recorded
+	// without keyframes can still be played, only seeking backwards doesn't work
+	void LoadKeyframes(std::string file)
+	{
+		keyframes.clear();
+		std::ifstream in(file, std::ios::binary);
+		Uint32 header[2];
+		while(in.read((char*)header, sizeof(header)))
+		{
+			Keyframe k;
+			k.frame = (int)header[0];
+			k.data.resize(header[1]);
+			if(!in.read(k.data.data(), header[1]))
+				break;
+			keyframes.push_back(std::move(k));
+		}
+	}
+
+	void WriteKeyframe()
+	{
+		Keyframe k;
+		k.frame = frame;
+		if(!SaveState::Save(k.data))
+			return;
+		Uint32 header[2] = { (Uint32)k.frame, (Uint32)k.data.size() };
+		keysOut.write((const char*)header, sizeof(header));
+		keysOut.write(k.data.data(), k.data.size());
+	}
+
+	bool StartPlayback(std::string file)
+	{
+		std::ifstream in(file);
+		if(!in)
+		{
+			PrintLog(LOG_IMPORTANT, "Replay: can't open %s", file.c_str());
+			return false;
+		}
+
+		frames.clear();
+		std::string line;
+		while(std::getline(in, line))
+		{
+			if(line.empty() || line[0] == ';')
+				continue;
+			if(line.compare(0, 4, "Map=") == 0)
+			{
+				mapName = line.substr(4);
+				continue;
+			}
+			std::vector<std::string> tokens;
+			tokenize(line, tokens, " ", true);
+			if(tokens.size() < 2)
+				continue;
+			ReplayFrame f;
+			f.ticks = atof(tokens[0].c_str());
+			f.held = (Uint32)strtoul(tokens[1].c_str(), NULL, 10);
+			for(int i = 2; i < (int)tokens.size(); i++)
+				f.events.push_back({ atoi(tokens[i].c_str() + 1), tokens[i][0] == '+' });
+			frames.push_back(f);
+		}
+		if(mapName.empty())
+		{
+			PrintLog(LOG_IMPORTANT, "Replay: %s has no map", file.c_str());
+			return false;
+		}
+		LoadKeyframes(file + ".keys");
+		playing = true;
+		frame = 0;
+		heldBinds = 0;
+		inputApplied = false;
+		PrintLog(LOG_INFO, "Replay: playing %s, %i frames of %s, %i keyframes", file.c_str(), (int)frames.size(), mapName.c_str(), (int)keyframes.size());
+		return true;
+	}
+
+	// Called before a level gets created
+	void OnLevelStart()
+	{
+		ResetRandomGenerators();
+		frame = 0;
+		pendingEvents.clear();
+		// only the first level played gets recorded
+		if(recordFile.empty() || recording)
+			return;
+		out.open(recordFile);
+		if(!out)
+		{
+			PrintLog(LOG_IMPORTANT, "Replay: can't write %s", recordFile.c_str());
+			recordFile.clear();
+			return;
+		}
+		recording = true;
+		keysOut.open(recordFile + ".keys", std::ios::binary);
+		sinceKeyframe = 0;
+		out << "; offsetted ticks, held binds, pressed (+) and released (-) binds" << std::endl;
+	}
+
+	void OnLevelEnd()
+	{
+		if(!recording)
+			return;
+		out.close();
+		keysOut.close();
+		recording = false;
+		PrintLog(LOG_INFO, "Replay: recorded %i frames to %s", frame, recordFile.c_str());
+		recordFile.clear();
+	}
+
+	void RecordBind(int bind, bool pressed)
+	{
+		if(!recording || bind < 0 || bind >= BIND_COUNT)
+			return;
+		// pausing can't be played back, the pause menu isn't recorded
+		if(bind == BIND_BACK || bind == BIND_ESCAPE)
+			return;
+		pendingEvents.push_back({ bind, pressed });
+	}
+
+	void RecordFrame(double ticks)
+	{
+		if(!recording)
+			return;
+		if(frame == 0)
+			out << "Map=" << Game::GetLevel()->fileName << std::endl;
+		// the first frame always gets one, so there's a keyframe before any frame
+		if(frame == 0 || sinceKeyframe >= keyframeInterval)
+		{
+			WriteKeyframe();
+			sinceKeyframe = 0;
+		}
+		sinceKeyframe += ticks;
+
+		Uint32 held = 0;
+		for(int i = 0; i < BIND_COUNT; i++)
+		{
+			if(IsBindPressed((KEYBINDS)i))
+				held |= 1 << i;
+		}
+		out << std::setprecision(17) << ticks << " " << held;
+		for(auto &e : pendingEvents)
+			out << " " << (e.pressed ? '+' : '-') << e.bind;
+		out << std::endl;
+		pendingEvents.clear();
+		frame++;
+	}
+
+	// Feeds the binds of the next frame to the game and returns its tick length
+	double PlayFrame()
+	{
+		if(IsFinished())
+			return 0;
+		ReplayFrame &f = frames[frame++];
+		// save states don't keep the bind state, so it's restored from the
+		// frame even when its input isn't handled again
+		if(inputApplied)
+		{
+			inputApplied = false;
+			heldBinds = f.held;
+			return f.ticks;
+		}
+		// same order as with real devices: the bind is marked pressed after
+		// its press is handled and released before its release is
+		for(auto &e : f.events)
+		{
+			if(e.pressed)
+			{
+				OnBindPress(e.bind);
+				heldBinds |= 1 << e.bind;
+			}
+			else
+			{
+				heldBinds &= ~(1 << e.bind);
+				OnBindUnpress(e.bind);
+			}
+		}
+		heldBinds = f.held;
+		for(int i = 0; i < BIND_COUNT; i++)
+		{
+			if(f.held & (1 << i))
+				OnBindHold(i);
+		}
+		return f.ticks;
+	}
+
+	// Gets to a frame by loading the last keyframe before it and simulating the
+	// frames in between without drawing them
+	bool Seek(int target)
+	{
+		if(!playing || Game::GetLevel() == nullptr)
+			return false;
+		target = std::min(target, (int)frames.size());
+		Uint64 seekStart = Profiler::GetTime();
+
+		const Keyframe *from = nullptr;
+		for(auto &k : keyframes)
+		{
+			if(k.frame <= target && (from == nullptr || k.frame > from->frame))
+				from = &k;
+		}
+		// playing on from where the replay is can be faster than loading
+		if(from != nullptr && (target < frame || from->frame > frame))
+		{
+			if(!SaveState::Load(from->data))
+				return false;
+			frame = from->frame;
+			inputApplied = true;
+		}
+		else if(target < frame)
+		{
+			PrintLog(LOG_IMPORTANT, "Replay: no keyframe to go back to frame %i from", target);
+			return false;
+		}
+
+		int simulated = 0;
+		while(frame < target && Game::GetState() == STATE_GAME && Fading::GetState() != FADING_STATE_BLACKNBACK)
+		{
+			Game::Update(PlayFrame());
+			simulated++;
+		}
+		PrintLog(LOG_INFO, "Replay: at frame %i, simulated %i frames in %.1f ms", frame, simulated, Profiler::GetElapsedMs(seekStart));
+		return frame == target;
+	}
+
+	// Starts the replay given with -play, and goes to the -seek frame
+	bool Start()
+	{
+		if(!StartPlayback(playFile))
+			return false;
+		if(fastForward)
+			FramePacing::SetMode(FRAME_PACING_UNCAPPED);
+		Game::CreateLevel(mapName);
+		Game::ResetPlayerLives();
+		Game::Start();
+		Game::SetState(STATE_GAME);
+		if(seekFrame > 0 && !Seek(seekFrame))
+			PrintLog(LOG_IMPORTANT, "Replay: couldn't seek to frame %i", seekFrame);
+		Profiler::Reset();
+		startTime = Profiler::GetTime();
+		return true;
+	}
+
+	// Hands the game over to the player once everything has been played.
+	// Fast-forward quits instead, also when the game left the level early
+	void Update()
+	{
+		if(!playing)
+			return;
+		if(fastForward)
+		{
+			bool leftLevel = Game::GetState() != STATE_GAME && Fading::GetState() == FADING_STATE_NONE;
+			if(IsFinished() || leftLevel)
+				Game::SetGameEndFlag();
+		}
+		else if(IsFinished() && !playFile.empty())
+		{
+			PrintLog(LOG_INFO, "Replay: finished at frame %i", frame);
+			playing = false;
+		}
+	}
+
+	void Report()
+	{
+		PrintLog(LOG_IMPORTANT, "Replay: fast-forwarded to frame %i in %.1f ms", frame, Profiler::GetElapsedMs(startTime));
+		Profiler::Report();
+	}
+
+	bool IsPlaybackRequested()
+	{
+		return !playFile.empty();
+	}
+
+	bool IsFastForward()
+	{
+		return fastForward;
+	}
+
+	bool IsRecording()
+	{
+		return recording;
+	}
+
+	bool IsPlaying()
+	{
+		return playing;
+	}
+
+	bool IsBindHeld(int bind)
+	{
+		return (heldBinds & (1 << bind)) != 0;
+	}
+
+	bool IsFinished()
+	{
+		return frame >= (int)frames.size();
+	}
+
+	int GetFrame()
+	{
+		return frame;
+	}
+
+	std::string GetMapName()
+	{
+		return mapName;
+	}
+
+	void Cleanup()
+	{
+		OnLevelEnd();
+		std::vector<ReplayFrame>().swap(frames);
+		std::vector<Keyframe>().swap(keyframes);
+		playing = false;
+	}
+}
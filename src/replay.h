@@ -0,0 +1,38 @@
+#ifndef _replay_h_
+#define _replay_h_
+
+#include <SDL.h>
+#include <string>
+
+// Records a level as it is played so it can be played back exactly.
+// Each game frame stores its tick length, the binds pressed and released
+// since the last one and the binds held down.
+// Recording is started with: platformer -record <file> [-keyframes <seconds>]
+// and also saves a keyframe every few seconds into <file>.keys, which lets
+// playback jump anywhere: platformer -play <file> [-seek <frame>] [-fastforward]
+// Fast-forward plays the whole replay uncapped and without drawing, then reports
+namespace Replay
+{
+	bool ParseArgs(int argc, char* argv[]);
+	bool StartPlayback(std::string file);
+	void OnLevelStart();
+	void OnLevelEnd();
+	void RecordBind(int bind, bool pressed);
+	void RecordFrame(double ticks);
+	double PlayFrame();
+	bool Seek(int target);
+	bool Start();
+	void Update();
+	void Report();
+	bool IsPlaybackRequested();
+	bool IsFastForward();
+	bool IsRecording();
+	bool IsPlaying();
+	bool IsBindHeld(int bind);
+	bool IsFinished();
+	int GetFrame();
+	std::string GetMapName();
+	void Cleanup();
+}
+
+#endif
@@ -0,0 +1,811 @@
+#include "savestate.h"
+#include <algorithm>
+#include <functional>
+#include <map>
+#include "aischeduler.h"
+#include "camera.h"
+#include "entities.h"
+#include "gamelogic.h"
+#include "graphics.h"
+#include "level.h"
+#include "navigation.h"
+#include "replay.h"
+#include "state.h"
+#include "streaming.h"
+#include "utils.h"
+
+extern std::vector<Bullet*> bullets;
+extern std::vector<Lightning*> lightnings;
+extern std::vector<Creature*> creatures;
+extern std::vector<Machinery*> machinery;
+extern std::vector<Pickup*> pickups;
+extern std::vector<Effect*> effects;
+extern std::vector<LightningBolt> lightningLibrary;
+extern std::map<std::string, CreatureData> creatureData;
+
+extern RandomGenerator entity_rg;
+extern RandomGenerator ai_rg;
+extern RandomGenerator level_rg;
+namespace Graphics
+{
+	extern RandomGenerator graphics_rg;
+}
+
+void StateWriter::WriteString(const std::string &s)
+{
+	Write((Uint32)s.size());
+	data.insert(data.end(), s.begin(), s.end());
+}
+
+std::string StateReader::ReadString()
+{
+	Uint32 size = Read<Uint32>();
+	if(failed || pos + size > data.size())
+	{
+		failed = true;
+		return "";
+	}
+	std::string s(data.begin() + pos, data.begin() + pos + size);
+	pos += size;
+	return s;
+}
+
+namespace SaveState
+{
+	Uint32 const MAGIC = 0x56415350; // "PSAV"
+	// bump whenever what's written changes, states of other versions are refused
+	Uint16 const VERSION = 4;
+	// magic, version, size and checksum of everything after the header
+	int const HEADER_SIZE = 14;
+	std::string const QUICKSAVE_FILE = "quicksave.sav";
+
+	// how entities point at each other (owners, attachments, picked blocks)
+	enum REF_TYPES
+	{
+		REF_NONE,
+		REF_PLAYER,
+		REF_CREATURE, // index among the saved creatures
+		REF_BULLET, // index among the saved bullets
+		REF_MACHINERY // entity ID
+	};
+
+	// entities in the order they are saved, references are indices into these
+	std::vector<Creature*> savedCreatures;
+	std::vector<Bullet*> savedBullets;
+	// assignments waiting for every entity to be loaded
+	std::vector<std::function<void()>> pendingRefs;
+
+	template<typename T>
+	int IndexOf(const std::vector<T*> &list, DynamicEntity *e)
+	{
+		for(int i = 0; i < (int)list.size(); i++)
+		{
+			if((DynamicEntity*)list[i] == e)
+				return i;
+		}
+		return -1;
+	}
+
+	// anything that isn't saved, like the shooter of a bullet that died since, is written as REF_NONE
+	void WriteRef(StateWriter &w, DynamicEntity *e)
+	{
+		Uint8 type = REF_NONE;
+		Sint32 index = -1;
+		if(e == nullptr)
+			type = REF_NONE;
+		else if(e == Game::GetPlayer())
+			type = REF_PLAYER;
+		else if((index = IndexOf(savedCreatures, e)) >= 0)
+			type = REF_CREATURE;
+		else if((index = IndexOf(savedBullets, e)) >= 0)
+			type = REF_BULLET;
+		else if(IndexOf(machinery, e) >= 0)
+		{
+			type = REF_MACHINERY;
+			index = e->entityID;
+		}
+		w.Write(type);
+		w.Write(index);
+	}
+
+	DynamicEntity* FindRef(Uint8 type, Sint32 index)
+	{
+		switch(type)
+		{
+			case REF_PLAYER:
+				return Game::GetPlayer();
+			case REF_CREATURE:
+				if(index >= 0 && index < (int)savedCreatures.size())
+					return savedCreatures[index];
+				break;
+			case REF_BULLET:
+				if(index >= 0 && index < (int)savedBullets.size())
+					return savedBullets[index];
+				break;
+			case REF_MACHINERY:
+				for(auto m : machinery)
+				{
+					if(m->entityID == index)
+						return m;
+				}
+				break;
+		}
+		return nullptr;
+	}
+
+	DynamicEntity* ReadRef(StateReader &r)
+	{
+		Uint8 type = r.Read<Uint8>();
+		Sint32 index = r.Read<Sint32>();
+		return FindRef(type, index);
+	}
+
+	// Bullets can be attached to creatures saved after them and the other way
+	// around, so these references are resolved once everything is loaded
+	template<typename T>
+	void ReadRefLater(StateReader &r, T *&to)
+	{
+		Uint8 type = r.Read<Uint8>();
+		Sint32 index = r.Read<Sint32>();
+		T **target = &to;
+		pendingRefs.push_back([type, index, target]()
+		{
+			*target = (T*)FindRef(type, index);
+		});
+	}
+
+	void WriteEntity(StateWriter &w, Entity &e)
+	{
+		double x, y;
+		e.GetPos(x, y);
+		w.Write(x);
+		w.Write(y);
+		w.Write(e.xNew);
+		w.Write(e.yNew);
+		w.Write(e.hitbox->GetRect().w);
+		w.Write(e.hitbox->GetRect().h);
+		w.Write(e.entityID);
+		w.Write(e.status);
+		w.Write(e.statusTimer);
+		w.Write(e.direction);
+		w.Write(e.blinkDamaged);
+
+		w.Write(e.sprite->GetTextureCoords());
+		w.Write(e.sprite->GetSpriteOffsetX());
+		w.Write(e.sprite->GetSpriteOffsetY());
+		const AnimationState &anim = e.sprite->GetAnimationState();
+		w.Write(anim.type);
+		w.Write(anim.playing);
+		w.Write(anim.frame);
+		w.Write(anim.frameInc);
+		w.Write(anim.time);
+		w.Write(e.sprite->shootingAnimTimer);
+	}
+
+	void ReadEntity(StateReader &r, Entity &e)
+	{
+		double x = r.Read<double>();
+		double y = r.Read<double>();
+		r.Read(e.xNew);
+		r.Read(e.yNew);
+		int w = r.Read<int>();
+		int h = r.Read<int>();
+		e.hitbox->SetSize(w, h);
+		e.SetPos(x, y);
+		r.Read(e.entityID);
+		r.Read(e.status);
+		r.Read(e.statusTimer);
+		r.Read(e.direction);
+		r.Read(e.blinkDamaged);
+
+		e.sprite->SetSpriteRect(r.Read<SDL_Rect>());
+		int offsetX = r.Read<int>();
+		int offsetY = r.Read<int>();
+		e.sprite->SetSpriteOffset(offsetX, offsetY);
+		AnimationState anim;
+		r.Read(anim.type);
+		r.Read(anim.playing);
+		r.Read(anim.frame);
+		r.Read(anim.frameInc);
+		r.Read(anim.time);
+		e.sprite->SetAnimationState(anim);
+		r.Read(e.sprite->shootingAnimTimer);
+	}
+
+	void WriteDynamic(StateWriter &w, DynamicEntity &e)
+	{
+		WriteEntity(w, e);
+		w.Write(e.GetVelocity());
+		w.Write(e.accel);
+		w.Write(e.ignoreWorld);
+		w.Write(e.ignoreGravity);
+		w.Write(e.gravityMultiplier);
+		WriteRef(w, e.attached);
+		w.Write(e.attX);
+		w.Write(e.attY);
+	}
+
+	void ReadDynamic(StateReader &r, DynamicEntity &e)
+	{
+		ReadEntity(r, e);
+		e.SetVelocity(r.Read<Velocity>());
+		r.Read(e.accel);
+		r.Read(e.ignoreWorld);
+		r.Read(e.ignoreGravity);
+		r.Read(e.gravityMultiplier);
+		ReadRefLater(r, e.attached);
+		r.Read(e.attX);
+		r.Read(e.attY);
+	}
+
+	// same states Creature::SetState can make
+	CreatureState* MakeState(Creature &c, CREATURE_STATES state)
+	{
+		switch(state)
+		{
+			case CREATURE_STATES::ONGROUND:
+				return new OnGroundState(&c);
+			case CREATURE_STATES::HANGING:
+				return new HangingState(&c);
+			case CREATURE_STATES::SLIDING:
+				return new SlidingState(&c);
+			case CREATURE_STATES::JUMPING:
+				return new JumpingState(&c);
+			default:
+				return new InAirState(&c);
+		}
+	}
+
+	void WriteCreature(StateWriter &w, Creature &c)
+	{
+		// goes first, entering a state changes the fields below
+		w.Write(c.state->GetState());
+		WriteDynamic(w, c);
+		w.Write(c.health);
+		w.Write(c.jumptime);
+		w.Write(c.jump_accel);
+		w.Write(c.term_vel);
+		w.Write(c.move_vel);
+		w.Write(c.shottime);
+		w.Write(c.charge_time);
+		w.Write(c.nearhookplatform);
+		w.Write(c.lefthook);
+		w.Write(c.interactTarget);
+		w.Write(c.weapon);
+		w.Write((Uint32)c.hitFrom.size());
+		for(auto &i : c.hitFrom)
+		{
+			w.Write(i.id);
+			w.Write(i.immunity);
+		}
+		w.Write(c.shotLocked);
+		w.Write(c.charging);
+		w.Write(c.onMachinery);
+		w.Write(c.doubleJumped);
+		WriteRef(w, c.pickedBlock);
+		w.Write(c.pushedFrom.left);
+		w.Write(c.pushedFrom.right);
+		w.Write(c.pushedFrom.top);
+		w.Write(c.pushedFrom.bottom);
+	}
+
+	void ReadCreature(StateReader &r, Creature &c)
+	{
+		c.SetState(MakeState(c, r.Read<CREATURE_STATES>()));
+		ReadDynamic(r, c);
+		r.Read(c.health);
+		r.Read(c.jumptime);
+		r.Read(c.jump_accel);
+		r.Read(c.term_vel);
+		r.Read(c.move_vel);
+		r.Read(c.shottime);
+		r.Read(c.charge_time);
+		r.Read(c.nearhookplatform);
+		r.Read(c.lefthook);
+		r.Read(c.interactTarget);
+		r.Read(c.weapon);
+		Uint32 hits = r.Read<Uint32>();
+		c.hitFrom.clear();
+		for(Uint32 i = 0; i < hits && !r.Failed(); i++)
+		{
+			DamageSource d;
+			r.Read(d.id);
+			r.Read(d.immunity);
+			c.hitFrom.push_back(d);
+		}
+		r.Read(c.shotLocked);
+		r.Read(c.charging);
+		r.Read(c.onMachinery);
+		r.Read(c.doubleJumped);
+		ReadRefLater(r, c.pickedBlock);
+		r.Read(c.pushedFrom.left);
+		r.Read(c.pushedFrom.right);
+		r.Read(c.pushedFrom.top);
+		r.Read(c.pushedFrom.bottom);
+	}
+
+	void WritePlayer(StateWriter &w, Player &p)
+	{
+		w.Write(p.GetAbility(0));
+		w.Write(p.GetAbility(1));
+		WriteCreature(w, p);
+		for(int i = 0; i < NUMWEAPONS; i++)
+		{
+			w.Write(p.ownedWeapons[i]);
+			w.Write(p.ammo[i]);
+		}
+		w.Write(p.chargedColored);
+		w.Write(p.idleTimer);
+	}
+
+	void ReadPlayer(StateReader &r, Player &p)
+	{
+		// also sets the colors and the interface up
+		ABILITIES first = r.Read<ABILITIES>();
+		ABILITIES second = r.Read<ABILITIES>();
+		p.SetAbilities(first, second);
+		ReadCreature(r, p);
+		for(int i = 0; i < NUMWEAPONS; i++)
+		{
+			r.Read(p.ownedWeapons[i]);
+			r.Read(p.ammo[i]);
+		}
+		r.Read(p.chargedColored);
+		r.Read(p.idleTimer);
+	}
+
+	void WriteMachinery(StateWriter &w)
+	{
+		std::vector<Machinery*> saved;
+		for(auto m : machinery)
+		{
+			// lava floors aren't made by the level loading and can't be made again
+			if(m != nullptr && !m->REMOVE_ME && m->type != MACHINERY_LAVAFLOOR)
+				saved.push_back(m);
+		}
+		w.Write((Uint32)saved.size());
+		for(auto m : saved)
+		{
+			w.Write(m->type);
+			w.Write(m->entityID);
+			WriteDynamic(w, *m);
+			w.Write(m->enabled);
+			w.Write(m->solid);
+			if(m->type == MACHINERY_PLATFORM)
+				w.Write(((Platform*)m)->currentPathPoint);
+		}
+	}
+
+	// Machinery is made again by the level the same way every time, so the saved
+	// ones are matched by entity ID. Whatever has no match got destroyed
+	bool ReadMachinery(StateReader &r)
+	{
+		std::vector<Machinery*> unmatched = machinery;
+		Uint32 count = r.Read<Uint32>();
+		for(Uint32 i = 0; i < count && !r.Failed(); i++)
+		{
+			MACHINERY_TYPES type = r.Read<MACHINERY_TYPES>();
+			int id = r.Read<int>();
+
+			auto m = std::find_if(unmatched.begin(), unmatched.end(), [type, id](Machinery *i)
+			{
+				return i->type == type && i->entityID == id;
+			});
+			if(m == unmatched.end())
+			{
+				PrintLog(LOG_IMPORTANT, "Save state has machinery %i the level doesn't", id);
+				return false;
+			}
+			ReadDynamic(r, **m);
+			r.Read((*m)->enabled);
+			r.Read((*m)->solid);
+			if(type == MACHINERY_PLATFORM)
+				r.Read(((Platform*)*m)->currentPathPoint);
+			unmatched.erase(m);
+		}
+		for(auto m : unmatched)
+			m->Remove();
+		return !r.Failed();
+	}
+
+	void WriteCreatures(StateWriter &w)
+	{
+		w.Write((Uint32)savedCreatures.size());
+		for(auto c : savedCreatures)
+		{
+			w.WriteString(c->type);
+			WriteCreature(w, *c);
+			// dead creatures have no AI
+			w.WriteString(c->IsAI() ? c->AI->GetName() : "");
+			if(c->IsAI())
+				c->AI->SaveState(w);
+		}
+	}
+
+	bool ReadCreatures(StateReader &r)
+	{
+		Uint32 count = r.Read<Uint32>();
+		for(Uint32 i = 0; i < count && !r.Failed(); i++)
+		{
+			std::string type = r.ReadString();
+			if(creatureData.find(type) == creatureData.end())
+			{
+				PrintLog(LOG_IMPORTANT, "Save state has invalid creature type %s", type.c_str());
+				return false;
+			}
+			Creature *c = new Creature(type);
+			savedCreatures.push_back(c);
+			// the AI comes after the state, so it isn't told about the state change
+			ReadCreature(r, *c);
+			std::string ai = r.ReadString();
+			if(ai.empty())
+				continue;
+			if(!c->SetAI(ai))
+			{
+				PrintLog(LOG_IMPORTANT, "Save state has invalid AI type %s", ai.c_str());
+				return false;
+			}
+			c->AI->LoadState(r);
+		}
+		return !r.Failed();
+	}
+
+	void WriteBullets(StateWriter &w)
+	{
+		w.Write((Uint32)savedBullets.size());
+		for(auto b : savedBullets)
+		{
+			w.Write(b->origin);
+			WriteDynamic(w, *b);
+			WriteRef(w, b->owner);
+			w.Write(b->lifetime);
+			w.Write(b->piercing);
+			w.Write(b->damage);
+		}
+	}
+
+	bool ReadBullets(StateReader &r)
+	{
+		Uint32 count = r.Read<Uint32>();
+		for(Uint32 i = 0; i < count && !r.Failed(); i++)
+		{
+			WEAPONS origin = r.Read<WEAPONS>();
+			// fired by the player only to have the right sprite and hitbox made, all of it is overwritten
+			Bullet *b = new Bullet(origin, *Game::GetPlayer());
+			savedBullets.push_back(b);
+			ReadDynamic(r, *b);
+			b->owner = ReadRef(r);
+			r.Read(b->lifetime);
+			r.Read(b->piercing);
+			r.Read(b->damage);
+		}
+		return !r.Failed();
+	}
+
+	void WriteLightnings(StateWriter &w)
+	{
+		std::vector<Lightning*> saved;
+		for(auto l : lightnings)
+		{
+			if(l != nullptr && !l->REMOVE_ME)
+				saved.push_back(l);
+		}
+		w.Write((Uint32)saved.size());
+		for(auto l : saved)
+		{
+			WriteRef(w, l->owner);
+			WriteDynamic(w, *l);
+			w.Write((Sint32)(l->bolt - lightningLibrary.data()));
+			w.Write(l->length);
+			w.Write(l->origin);
+			w.Write(l->lifetime);
+			w.Write(l->piercing);
+		}
+	}
+
+	bool ReadLightnings(StateReader &r)
+	{
+		Uint32 count = r.Read<Uint32>();
+		for(Uint32 i = 0; i < count && !r.Failed(); i++)
+		{
+			DynamicEntity *owner = ReadRef(r);
+			// made by the player like bullets are, the owner is put back after
+			Lightning *l = new Lightning(owner != nullptr ? *owner : *Game::GetPlayer());
+			l->owner = owner;
+			ReadDynamic(r, *l);
+			Sint32 bolt = r.Read<Sint32>();
+			if(bolt < 0 || bolt >= (int)lightningLibrary.size())
+				return false;
+			l->bolt = &lightningLibrary[bolt];
+			r.Read(l->length);
+			r.Read(l->origin);
+			r.Read(l->lifetime);
+			r.Read(l->piercing);
+		}
+		return !r.Failed();
+	}
+
+	void WritePickups(StateWriter &w)
+	{
+		std::vector<Pickup*> saved;
+		for(auto p : pickups)
+		{
+			if(p != nullptr && !p->REMOVE_ME)
+				saved.push_back(p);
+		}
+		w.Write((Uint32)saved.size());
+		for(auto p : saved)
+		{
+			w.Write(p->type);
+			WriteEntity(w, *p);
+		}
+	}
+
+	bool ReadPickups(StateReader &r)
+	{
+		Uint32 count = r.Read<Uint32>();
+		for(Uint32 i = 0; i < count && !r.Failed(); i++)
+		{
+			Pickup *p = new Pickup(r.Read<PICKUP_TYPES>());
+			ReadEntity(r, *p);
+		}
+		return !r.Failed();
+	}
+
+	void WriteEffects(StateWriter &w)
+	{
+		std::vector<Effect*> saved;
+		for(auto e : effects)
+		{
+			if(e != nullptr && !e->REMOVE_ME)
+				saved.push_back(e);
+		}
+		w.Write((Uint32)saved.size());
+		for(auto e : saved)
+		{
+			w.Write(e->type);
+			WriteEntity(w, *e);
+		}
+	}
+
+	bool ReadEffects(StateReader &r)
+	{
+		Uint32 count = r.Read<Uint32>();
+		for(Uint32 i = 0; i < count && !r.Failed(); i++)
+		{
+			Effect *e = new Effect(r.Read<EFFECT_TYPES>());
+			ReadEntity(r, *e);
+		}
+		return !r.Failed();
+	}
+
+	void WriteCamera(StateWriter &w)
+	{
+		Camera *camera = Graphics::GetCamera();
+		w.Write(camera->IsAttachedTo(Game::GetPlayer()));
+		w.Write(camera->GetPRect());
+		w.Write(camera->GetVirtualCamRect());
+	}
+
+	void ReadCamera(StateReader &r)
+	{
+		Camera *camera = Graphics::GetCamera();
+		if(r.Read<bool>())
+			camera->Attach(*Game::GetPlayer());
+		camera->SetPRect(r.Read<PrecisionRect>());
+		camera->SetVirtualCamRect(r.Read<SDL_Rect>());
+	}
+
+	// field by field, the struct has padding that would go into the checksum
+	void WriteGenerator(StateWriter &w, RandomGenerator &rg)
+	{
+		RandomState s = rg.GetState();
+		w.Write(s.seed);
+		w.Write(s.seedBackup);
+		w.Write(s.genSeed);
+		w.Write(s.draws);
+	}
+
+	void ReadGenerator(StateReader &r, RandomGenerator &rg)
+	{
+		RandomState s;
+		r.Read(s.seed);
+		r.Read(s.seedBackup);
+		r.Read(s.genSeed);
+		r.Read(s.draws);
+		rg.SetState(s);
+	}
+
+	void WriteRandom(StateWriter &w)
+	{
+		WriteGenerator(w, entity_rg);
+		WriteGenerator(w, ai_rg);
+		WriteGenerator(w, level_rg);
+		WriteGenerator(w, Graphics::graphics_rg);
+	}
+
+	void ReadRandom(StateReader &r)
+	{
+		ReadGenerator(r, entity_rg);
+		ReadGenerator(r, ai_rg);
+		ReadGenerator(r, level_rg);
+		ReadGenerator(r, Graphics::graphics_rg);
+	}
+
+	bool Save(std::vector<char> &data)
+	{
+		Level *level = Game::GetLevel();
+		Player *player = Game::GetPlayer();
+		if(level == nullptr || !level->loaded || player == nullptr)
+			return false;
+		Uint64 start = SDL_GetPerformanceCounter();
+
+		savedCreatures.clear();
+		for(auto c : creatures)
+		{
+			if(c != nullptr && !c->REMOVE_ME)
+				savedCreatures.push_back(c);
+		}
+		savedBullets.clear();
+		for(auto b : bullets)
+		{
+			if(b != nullptr && !b->REMOVE_ME)
+				savedBullets.push_back(b);
+		}
+
+		data.clear();
+		StateWriter w(data);
+		w.Write(MAGIC);
+		w.Write(VERSION);
+		// size and checksum, filled in at the end
+		w.Write((Uint32)0);
+		w.Write((Uint32)0);
+
+		w.WriteString(level->fileName);
+		level->SaveState(w);
+		WriteMachinery(w);
+		WritePlayer(w, *player);
+		WriteCreatures(w);
+		WriteBullets(w);
+		WriteLightnings(w);
+		WritePickups(w);
+		WriteEffects(w);
+		WriteCamera(w);
+		w.Write(AIScheduler::GetStaggerSlot());
+		w.Write(Navigation::GetFlowTarget());
+		WriteRandom(w);
+
+		Uint32 size = (Uint32)data.size() - HEADER_SIZE;
+		Uint32 checksum = HashData(&data[HEADER_SIZE], size);
+		memcpy(&data[6], &size, sizeof(size));
+		memcpy(&data[10], &checksum, sizeof(checksum));
+
+		savedCreatures.clear();
+		savedBullets.clear();
+		PrintLog(LOG_INFO, "Saved state: %i bytes in %.3f ms", (int)data.size(),
+			(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+		return true;
+	}
+
+	bool LoadEntities(StateReader &r, Level &level)
+	{
+		if(!level.LoadState(r))
+			return false;
+		level.LoadNonRandomElements();
+		level.LoadEntities();
+		if(!ReadMachinery(r))
+			return false;
+		ReadPlayer(r, *Game::GetPlayer());
+		if(!ReadCreatures(r) || !ReadBullets(r) || !ReadLightnings(r) || !ReadPickups(r) || !ReadEffects(r))
+			return false;
+		for(auto &i : pendingRefs)
+			i();
+		ReadCamera(r);
+		AIScheduler::SetStaggerSlot(r.Read<int>());
+		Navigation::RestoreFlowTarget(r.Read<int>());
+		// after everything else, making entities can use up random numbers
+		ReadRandom(r);
+		return !r.Failed();
+	}
+
+	bool Load(const std::vector<char> &data)
+	{
+		Level *level = Game::GetLevel();
+		if(level == nullptr || !level->loaded)
+			return false;
+		Uint64 start = SDL_GetPerformanceCounter();
+
+		// everything is checked before the level gets torn down
+		StateReader header(data);
+		Uint32 magic = header.Read<Uint32>();
+		Uint16 version = header.Read<Uint16>();
+		Uint32 size = header.Read<Uint32>();
+		Uint32 checksum = header.Read<Uint32>();
+		if(header.Failed() || magic != MAGIC)
+		{
+			PrintLog(LOG_IMPORTANT, "Not a save state");
+			return false;
+		}
+		if(version != VERSION)
+		{
+			PrintLog(LOG_IMPORTANT, "Save state version %i isn't supported, expected %i", version, VERSION);
+			return false;
+		}
+		if(size != data.size() - HEADER_SIZE || checksum != HashData(&data[HEADER_SIZE], size))
+		{
+			PrintLog(LOG_IMPORTANT, "Save state is damaged");
+			return false;
+		}
+		StateReader r(data, HEADER_SIZE);
+		std::string levelName = r.ReadString();
+		if(levelName != level->fileName)
+		{
+			PrintLog(LOG_IMPORTANT, "Save state is of %s, not %s", levelName.c_str(), level->fileName.c_str());
+			return false;
+		}
+
+		level->loaded = false;
+		level->ResetToSnapshot();
+		savedCreatures.clear();
+		savedBullets.clear();
+		pendingRefs.clear();
+		bool ok = LoadEntities(r, *level);
+		savedCreatures.clear();
+		savedBullets.clear();
+		pendingRefs.clear();
+		if(!ok)
+		{
+			PrintLog(LOG_IMPORTANT, "Couldn't load save state, restarting the level");
+			level->Reload();
+			return false;
+		}
+		Streaming::Start(*level, Graphics::GetCamera()->GetVirtualCamRect(), Graphics::GetVisibleRect());
+		level->loaded = true;
+
+		PrintLog(LOG_INFO, "Loaded state: %i bytes in %.3f ms", (int)data.size(),
+			(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+		return true;
+	}
+
+	bool SaveToFile(std::string file)
+	{
+		std::vector<char> data;
+		if(!Save(data))
+			return false;
+		SDL_RWops *rw = SDL_RWFromFile(file.c_str(), "wb");
+		if(!rw)
+		{
+			PrintLog(LOG_IMPORTANT, "Can't write %s", file.c_str());
+			return false;
+		}
+		bool written = SDL_RWwrite(rw, data.data(), 1, data.size()) == data.size();
+		SDL_RWclose(rw);
+		return written;
+	}
+
+	bool LoadFromFile(std::string file)
+	{
+		std::vector<char> data;
+		if(!ReadFileData(file, data))
+		{
+			PrintLog(LOG_IMPORTANT, "Can't open %s", file.c_str());
+			return false;
+		}
+		return Load(data);
+	}
+
+	void QuickSave()
+	{
+		if(SaveToFile(QUICKSAVE_FILE))
+			PrintLog(LOG_INFO, "Quicksaved");
+	}
+
+	void QuickLoad()
+	{
+		// would break what's being recorded or played back
+		if(Replay::IsRecording() || Replay::IsPlaying())
+			return;
+		if(LoadFromFile(QUICKSAVE_FILE))
+			PrintLog(LOG_INFO, "Quickloaded");
+	}
+}
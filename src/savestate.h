@@ -0,0 +1,97 @@
+#ifndef _savestate_h_
+#define _savestate_h_
+
+#include <SDL.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Appends values to a save state buffer as they are in memory
+class StateWriter
+{
+	private:
+		std::vector<char> &data;
+
+	public:
+		StateWriter(std::vector<char> &data) : data(data) {};
+		template<typename T>
+		void Write(const T &value)
+		{
+			const char *bytes = (const char*)&value;
+			data.insert(data.end(), bytes, bytes + sizeof(T));
+		};
+		// only for plain structs and numbers
+		template<typename T>
+		void WriteVector(const std::vector<T> &v)
+		{
+			Write((Uint32)v.size());
+			const char *bytes = (const char*)v.data();
+			data.insert(data.end(), bytes, bytes + v.size() * sizeof(T));
+		};
+		void WriteString(const std::string &s);
+};
+
+// Reads values back in the order they were written. Running past the end
+// marks the reader as failed and gives zeroes from then on
+class StateReader
+{
+	private:
+		const std::vector<char> &data;
+		size_t pos;
+		bool failed = false;
+
+	public:
+		StateReader(const std::vector<char> &data, size_t pos = 0) : data(data), pos(pos) {};
+		template<typename T>
+		void Read(T &value)
+		{
+			if(failed || pos + sizeof(T) > data.size())
+			{
+				failed = true;
+				value = T();
+				return;
+			}
+			memcpy(&value, &data[pos], sizeof(T));
+			pos += sizeof(T);
+		};
+		template<typename T>
+		T Read()
+		{
+			T value;
+			Read(value);
+			return value;
+		};
+		template<typename T>
+		void ReadVector(std::vector<T> &v)
+		{
+			Uint32 size = Read<Uint32>();
+			if(failed || pos + (size_t)size * sizeof(T) > data.size())
+			{
+				failed = true;
+				v.clear();
+				return;
+			}
+			v.resize(size);
+			memcpy(v.data(), &data[pos], size * sizeof(T));
+			pos += size * sizeof(T);
+		};
+		std::string ReadString();
+		bool Failed() { return failed; };
+};
+
+// Snapshots of the whole running level: the player, creatures with their AI,
+// bullets, machinery, pickups, effects, tiles changed since the level was
+// loaded, the camera, the flow field target and the random generators.
+// A state can only be loaded into the level it was saved in.
+// Quicksave is F5, quickload is F9
+namespace SaveState
+{
+	bool Save(std::vector<char> &data);
+	bool Load(const std::vector<char> &data);
+	bool SaveToFile(std::string file);
+	bool LoadFromFile(std::string file);
+	void QuickSave();
+	void QuickLoad();
+}
+
+#endif
@@ -7,6 +7,8 @@
 namespace Sound
 {
 	std::map<std::string, Mix_Chunk*> loadedSounds;
+	// whole music files read into memory ahead of time
+	std::map<std::string, std::vector<char>> loadedMusicData;
 
 	Mix_Music *activeMusic = NULL;
 	bool restartMusic = false;
@@ -46,10 +48,36 @@ namespace Sound
 		return volumeMusic;
 	}
 
+	std::string GetSfxFile(std::string soundName)
+	{
+		return "assets/sounds/" + soundName + ".wav";
+	}
+
+	std::string GetMusicFile(std::string musicName)
+	{
+		return "assets/music/" + musicName;
+	}
+
+	// Takes ownership of an already decoded sound
+	void AddSfx(std::string soundName, Mix_Chunk *chunk)
+	{
+		std::string soundFile = GetSfxFile(soundName);
+		if(loadedSounds.find(soundFile) != loadedSounds.end())
+		{
+			Mix_FreeChunk(chunk);
+			return;
+		}
+		loadedSounds[soundFile] = chunk;
+	}
+
+	void AddMusicData(std::string musicName, std::vector<char> &data)
+	{
+		loadedMusicData[GetMusicFile(musicName)].swap(data);
+	}
+
 	void PlaySfx(std::string soundName)
 	{
-		std::string soundFile;
-		soundFile = "assets/sounds/" + soundName + ".wav";
+		std::string soundFile = GetSfxFile(soundName);
 
 		Mix_Chunk *activeSound = NULL;
 		if(loadedSounds.find(soundFile) == loadedSounds.end())
@@ -64,10 +92,13 @@ namespace Sound
 
 	void PlayMusic(std::string musicName)
 	{
-		std::string musicFile;
-		musicFile = "assets/music/" + musicName;
+		std::string musicFile = GetMusicFile(musicName);
 
-		activeMusic = Mix_LoadMUS(musicFile.c_str());
+		auto data = loadedMusicData.find(musicFile);
+		if(data != loadedMusicData.end() && !data->second.empty())
+			activeMusic = Mix_LoadMUS_RW(SDL_RWFromConstMem(data->second.data(), (int)data->second.size()), 1);
+		else
+			activeMusic = Mix_LoadMUS(musicFile.c_str());
 		if(!activeMusic) {
 			PrintLog(LOG_IMPORTANT, "Mix_LoadMUS: %s\n", Mix_GetError());
 		}
@@ -92,6 +123,12 @@ namespace Sound
 	void OnMusicFinished()
 	{
 		restartMusic = true;
+		// wakes up the main loop if it's waiting on a menu, so the music
+		// restarts right away. Pushing events is safe from any thread
+		SDL_Event e;
+		SDL_zero(e);
+		e.type = SDL_USEREVENT;
+		SDL_PushEvent(&e);
 	}
 
 	void PauseMusic()
@@ -117,6 +154,9 @@ namespace Sound
 		{
 			Mix_FreeChunk(i.second);
 		}
+		// music could still be streaming from a preloaded buffer
+		StopMusic();
+		loadedMusicData.clear();
 		// Close sound mixer
 		while(Mix_Init(0))
 			Mix_Quit();
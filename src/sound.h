@@ -2,10 +2,16 @@
 #define _sound_h_ 
 
 #include <string>
+#include <vector>
+#include "SDL_mixer.h"
 
 namespace Sound
 {
 	void Init();
+	std::string GetSfxFile(std::string soundName);
+	std::string GetMusicFile(std::string musicName);
+	void AddSfx(std::string soundName, Mix_Chunk *chunk);
+	void AddMusicData(std::string musicName, std::vector<char> &data);
 	void PlaySfx(std::string sound);
 	void PlayMusic(std::string musicName);
 	void ProcessMusic();
@@ -3,22 +3,20 @@
 
 Sprite::~Sprite() {}
 
-Sprite::Sprite(SDL_Texture **tex, SDL_Rect rect)
+Sprite::Sprite(TextureHandle tex, SDL_Rect rect)
 {
 	this->rect = rect;
 	sprite_sheet = tex;
-	current_anim = last_anim = ANIMATION_NONE;
 	SetSpriteOffset(0, 0);
 }
 
-Sprite::Sprite(SDL_Texture **tex, int x, int y, int h, int w)
+Sprite::Sprite(TextureHandle tex, int x, int y, int h, int w)
 {
 	this->rect.x = x;
 	this->rect.y = y;
 	this->rect.h = h;
 	this->rect.w = w;
 	sprite_sheet = tex;
-	current_anim = last_anim = ANIMATION_NONE;
 	SetSpriteOffset(0, 0);
 }
 
@@ -34,57 +32,63 @@ void Sprite::SetAnimation(ANIMATION_TYPE type)
 		type = ANIMATION_JUMPING;
 	if(!AnimationExists(type))
 		type = ANIMATION_STANDING;
+	if(!AnimationExists(type))
+		return;
 
-	if(last_anim != type)
+	if(animState.type != type)
 	{
-		current_anim = type;
-		PrintLog(LOG_INFO, "Set animation to %i. Old was %i", type, last_anim);
-		animation.at(type).SetCurrentFrame(1);
-		this->Animate();
-		last_anim = type;
+		PrintLog(LOG_INFO, "Set animation to %i. Old was %i", type, animState.type);
+		animState.Start(type);
+		animations->at(type).GetFrameCoords(animState.frame, rect.x, rect.y);
 	}
-
 }
 
 bool Sprite::AnimationExists(ANIMATION_TYPE type)
 {
-	return (animation.find(type) != animation.end());
+	return animations != nullptr && animations->find(type) != animations->end();
 }
 
-void Sprite::Animate()
+// Time comes from the simulation, so sprites stay in step with the game speed
+void Sprite::AdvanceAnimation(double ms)
 {
-	if(current_anim != ANIMATION_NONE)
-		animation.at(current_anim).Animate(rect.x, rect.y);
+	if(!animState.playing)
+		return;
+	const Animation &animation = animations->at(animState.type);
+	if(animState.Advance(animation, ms))
+		animation.GetFrameCoords(animState.frame, rect.x, rect.y);
 }
 
 void Sprite::SetCurrentFrame(int frame)
 {
-	animation.at(current_anim).ShowFrame(frame, rect.x, rect.y);
-	current_anim = ANIMATION_NONE;
+	if(!AnimationExists(animState.type))
+		return;
+	animations->at(animState.type).GetFrameCoords(frame, rect.x, rect.y);
+	animState.playing = false;
 }
 
 ANIMATION_TYPE Sprite::GetAnimation()
 {
-	return last_anim;
+	return animState.type;
 }
 
-void Sprite::AddAnimation(ANIMATION_TYPE type, int offset_x, int offset_y, int frames, int interval, int fps, ANIM_LOOP_TYPES loop, int loopFrom)
+void Sprite::SetAnimationSet(const AnimationSet *animations)
 {
-	animation[type] = Animation(offset_x, offset_y, frames, interval, fps, loop, loopFrom);
+	this->animations = animations;
+	animState = AnimationState();
 }
 
 void Sprite::StopAnimation()
 {
-	if(current_anim != ANIMATION_NONE)
+	if(animState.playing)
 	{
-		animation.at(current_anim).ShowFrame(-1, rect.x, rect.y);
-		current_anim = ANIMATION_NONE;
+		animations->at(animState.type).GetFrameCoords(-1, rect.x, rect.y);
+		animState.playing = false;
 	}
 }
 
-SDL_Texture* Sprite::GetSpriteSheet()
+TextureHandle Sprite::GetSpriteSheet()
 {
-	return *sprite_sheet;
+	return sprite_sheet;
 }
 
 void Sprite::SetSpriteOffset(int x, int y)
@@ -119,7 +123,15 @@ void Sprite::SetSpriteRect(SDL_Rect rect)
 	this->rect = rect;
 }
 
-void Sprite::SetSpriteTexture(SDL_Texture **tex)
+void Sprite::SetSpriteTexture(TextureHandle tex)
 {
 	sprite_sheet = tex;
 }
+
+// Moves the sprite when the sheet gets placed inside a bigger texture.
+// Animation tables are shifted separately since they are shared
+void Sprite::ShiftTextureCoords(int x, int y)
+{
+	rect.x += x;
+	rect.y += y;
+}
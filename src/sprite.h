@@ -11,10 +11,10 @@ class Sprite
 {
 	private:
 		SDL_Rect rect;
-		std::map<ANIMATION_TYPE, Animation> animation;
-		ANIMATION_TYPE current_anim;
-		ANIMATION_TYPE last_anim;
-		SDL_Texture **sprite_sheet;
+		// owned by the entity graphics data, never changed once loaded
+		const AnimationSet *animations = nullptr;
+		AnimationState animState;
+		TextureHandle sprite_sheet;
 
 		int offset_x;
 		int offset_y;
@@ -23,28 +23,31 @@ class Sprite
 		double shootingAnimTimer = 0;
 		//Initializes the variables
 		Sprite() {
-			current_anim = last_anim = ANIMATION_NONE;
+			sprite_sheet = INVALID_TEXTURE_HANDLE;
 			offset_x = offset_y = 0;
 			shootingAnimTimer = 0;
 		};
 		~Sprite();
 
-		Sprite(SDL_Texture **tex, SDL_Rect rect);
-		Sprite(SDL_Texture **tex, int x, int y, int h, int w);
+		Sprite(TextureHandle tex, SDL_Rect rect);
+		Sprite(TextureHandle tex, int x, int y, int h, int w);
 		SDL_Rect GetTextureCoords();
-		void AddAnimation(ANIMATION_TYPE type, int offset_x, int offset_y, int frames, int interval, int fps, ANIM_LOOP_TYPES loop, int loopFrom);
+		void SetAnimationSet(const AnimationSet *animations);
 		void SetAnimation(ANIMATION_TYPE type);
 		bool AnimationExists(ANIMATION_TYPE type);
 		void StopAnimation();
 		ANIMATION_TYPE GetAnimation();
-		SDL_Texture* GetSpriteSheet();
+		TextureHandle GetSpriteSheet();
 		void SetSpriteOffset(int x, int y);
 		int GetSpriteOffsetX();
 		int GetSpriteOffsetY();
 		void SetSpriteRect(SDL_Rect rect);
-		void SetSpriteTexture(SDL_Texture **tex);
+		void SetSpriteTexture(TextureHandle tex);
+		void ShiftTextureCoords(int x, int y);
 		void SetCurrentFrame(int frame);
-		void Animate();
+		void AdvanceAnimation(double ms);
+		const AnimationState& GetAnimationState() { return animState; };
+		void SetAnimationState(const AnimationState &state) { animState = state; };
 		void SetSpriteSize(int width, int height);
 		void SetSpriteY(int y);
 };
@@ -0,0 +1,327 @@
+#include "streaming.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "level.h"
+#include "tiles.h"
+#include "utils.h"
+
+extern std::vector<TileLayerData> tileLayers;
+extern std::vector<CustomTile> tileset;
+
+namespace Streaming
+{
+	int const SECTOR_SIZE = 32; // in tiles
+	// sectors around the view that get loaded ahead of the camera
+	int const PRELOAD_MARGIN = 1;
+	// tiles kept loaded beyond what's around the view, in bytes
+	size_t const MEMORY_BUDGET = 4 * 1024 * 1024;
+
+	enum SECTOR_STATES
+	{
+		SECTOR_UNLOADED,
+		SECTOR_LOADING,
+		SECTOR_LOADED
+	};
+
+	struct Sector
+	{
+		SECTOR_STATES state = SECTOR_UNLOADED;
+		bool entitiesSpawned = false;
+		int tileCount = 0;
+		Uint32 lastNeeded = 0; // update when the sector was last near the view
+	};
+
+	struct BuiltSector
+	{
+		int sector;
+		std::vector<Tile*> tiles;
+	};
+
+	Level *level = nullptr;
+	int sectorsX = 0;
+	int sectorsY = 0;
+	std::vector<Sector> sectors;
+	size_t loadedBytes = 0;
+	Uint32 updateCount = 0;
+
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable wake;
+	// guarded by the mutex
+	std::deque<int> requests;
+	std::vector<BuiltSector> built;
+	bool quit = false;
+
+	SDL_Rect GetSectorTiles(int sector)
+	{
+		int x = sector % sectorsX * SECTOR_SIZE;
+		int y = sector / sectorsX * SECTOR_SIZE;
+		return { x, y, std::min(SECTOR_SIZE, tileLayers[0].width - x), std::min(SECTOR_SIZE, tileLayers[0].height - y) };
+	}
+
+	// Safe on any thread: the layer data it reads doesn't change while a sector isn't loaded
+	std::vector<Tile*> BuildSector(int sector)
+	{
+		std::vector<Tile*> result;
+		SDL_Rect area = GetSectorTiles(sector);
+		for(int layer = 0; layer < (int)tileLayers.size(); layer++)
+		{
+			TileLayerData &data = tileLayers[layer];
+			if(!data.IsStreamed())
+				continue;
+			for(int x = area.x; x < area.x + area.w; x++)
+			{
+				for(int y = area.y; y < area.y + area.h; y++)
+				{
+					Uint16 gid = data.GidAt(x, y);
+					if(gid)
+						result.push_back(new Tile(x, y, layer, &tileset[gid - 1]));
+				}
+			}
+		}
+		return result;
+	}
+
+	void WorkerThread()
+	{
+		while(true)
+		{
+			int sector;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [] { return quit || !requests.empty(); });
+				if(quit)
+					return;
+				sector = requests.front();
+				requests.pop_front();
+			}
+			std::vector<Tile*> tiles = BuildSector(sector);
+			std::lock_guard<std::mutex> lock(mutex);
+			built.push_back({ sector, tiles });
+		}
+	}
+
+	void Place(int sector, std::vector<Tile*> &tiles)
+	{
+		for(auto &t : tiles)
+			tileLayers[t->layer].At(t->x, t->y) = t;
+		sectors[sector].state = SECTOR_LOADED;
+		sectors[sector].tileCount = (int)tiles.size();
+		loadedBytes += tiles.size() * sizeof(Tile);
+	}
+
+	void PlaceBuilt()
+	{
+		std::vector<BuiltSector> ready;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			ready.swap(built);
+		}
+		for(auto &i : ready)
+			Place(i.sector, i.tiles);
+	}
+
+	// For sectors on screen, which can't wait for the worker
+	void LoadNow(int sector)
+	{
+		if(sectors[sector].state == SECTOR_LOADING)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				auto i = std::find(requests.begin(), requests.end(), sector);
+				if(i != requests.end())
+				{
+					requests.erase(i);
+					sectors[sector].state = SECTOR_UNLOADED;
+				}
+			}
+			// the worker is building it right now
+			while(sectors[sector].state == SECTOR_LOADING)
+			{
+				std::this_thread::yield();
+				PlaceBuilt();
+			}
+		}
+		if(sectors[sector].state == SECTOR_UNLOADED)
+		{
+			std::vector<Tile*> tiles = BuildSector(sector);
+			Place(sector, tiles);
+		}
+	}
+
+	void Request(int sector)
+	{
+		sectors[sector].state = SECTOR_LOADING;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			requests.push_back(sector);
+		}
+		wake.notify_one();
+	}
+
+	void Unload(int sector)
+	{
+		SDL_Rect area = GetSectorTiles(sector);
+		for(auto &layer : tileLayers)
+		{
+			if(!layer.IsStreamed())
+				continue;
+			for(int x = area.x; x < area.x + area.w; x++)
+			{
+				for(int y = area.y; y < area.y + area.h; y++)
+				{
+					// clears its own slot
+					delete layer.At(x, y);
+				}
+			}
+		}
+		loadedBytes -= std::min(loadedBytes, sectors[sector].tileCount * sizeof(Tile));
+		sectors[sector].tileCount = 0;
+		sectors[sector].state = SECTOR_UNLOADED;
+	}
+
+	// Sectors touched by a rectangle in pixels, grown by a margin in sectors
+	SDL_Rect GetSectorRange(SDL_Rect view, int margin)
+	{
+		int sectorPixels = SECTOR_SIZE * TILESIZE;
+		int x1 = std::max(0, view.x / sectorPixels - margin);
+		int y1 = std::max(0, view.y / sectorPixels - margin);
+		int x2 = std::min(sectorsX - 1, (view.x + view.w) / sectorPixels + margin);
+		int y2 = std::min(sectorsY - 1, (view.y + view.h) / sectorPixels + margin);
+		return { x1, y1, x2 - x1 + 1, y2 - y1 + 1 };
+	}
+
+	void Update(SDL_Rect area, SDL_Rect view)
+	{
+		if(sectors.empty())
+			return;
+		updateCount++;
+		PlaceBuilt();
+
+		SDL_Rect spawn = GetSectorRange(area, PRELOAD_MARGIN);
+		for(int sy = spawn.y; sy < spawn.y + spawn.h; sy++)
+		{
+			for(int sx = spawn.x; sx < spawn.x + spawn.w; sx++)
+			{
+				Sector &s = sectors[sy * sectorsX + sx];
+				if(!s.entitiesSpawned)
+				{
+					SDL_Rect tiles = GetSectorTiles(sy * sectorsX + sx);
+					level->SpawnEntities({ tiles.x * TILESIZE, tiles.y * TILESIZE, tiles.w * TILESIZE, tiles.h * TILESIZE });
+					s.entitiesSpawned = true;
+				}
+			}
+		}
+
+		SDL_Rect visible = GetSectorRange(view, 0);
+		SDL_Rect viewNeeded = GetSectorRange(view, PRELOAD_MARGIN);
+		SDL_Rect needed;
+		SDL_UnionRect(&spawn, &viewNeeded, &needed);
+		for(int sy = needed.y; sy < needed.y + needed.h; sy++)
+		{
+			for(int sx = needed.x; sx < needed.x + needed.w; sx++)
+			{
+				int sector = sy * sectorsX + sx;
+				Sector &s = sectors[sector];
+				s.lastNeeded = updateCount;
+				SDL_Point p = { sx, sy };
+				if(SDL_PointInRect(&p, &visible))
+				{
+					if(s.state != SECTOR_LOADED)
+						LoadNow(sector);
+				}
+				else if(s.state == SECTOR_UNLOADED)
+					Request(sector);
+			}
+		}
+
+		// least recently needed sectors go first
+		while(loadedBytes > MEMORY_BUDGET)
+		{
+			int oldest = -1;
+			for(int i = 0; i < (int)sectors.size(); i++)
+			{
+				if(sectors[i].state != SECTOR_LOADED || sectors[i].lastNeeded == updateCount)
+					continue;
+				if(oldest < 0 || sectors[i].lastNeeded < sectors[oldest].lastNeeded)
+					oldest = i;
+			}
+			if(oldest < 0)
+				break;
+			Unload(oldest);
+		}
+	}
+
+	void Start(Level &level, SDL_Rect area, SDL_Rect view)
+	{
+		Cleanup();
+		Streaming::level = &level;
+		if(tileLayers.empty())
+			return;
+		sectorsX = (tileLayers[0].width + SECTOR_SIZE - 1) / SECTOR_SIZE;
+		sectorsY = (tileLayers[0].height + SECTOR_SIZE - 1) / SECTOR_SIZE;
+		sectors.resize(sectorsX * sectorsY);
+
+		for(int layer = 0; layer < (int)tileLayers.size(); layer++)
+		{
+			TileLayerData &data = tileLayers[layer];
+			if(data.IsStreamed())
+				continue;
+			for(int x = 0; x < data.width; x++)
+			{
+				for(int y = 0; y < data.height; y++)
+				{
+					if(data.GidAt(x, y))
+						data.At(x, y) = new Tile(x, y, layer, &tileset[data.GidAt(x, y) - 1]);
+				}
+			}
+		}
+
+		quit = false;
+		worker = std::thread(WorkerThread);
+		Update(area, view);
+		PrintLog(LOG_INFO, "Streaming: %ix%i sectors, %i loaded at start", sectorsX, sectorsY, GetLoadedSectorCount());
+	}
+
+	// Call before the tiles are deleted
+	void Cleanup()
+	{
+		if(worker.joinable())
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				quit = true;
+			}
+			wake.notify_one();
+			worker.join();
+		}
+		// built but never placed
+		for(auto &i : built)
+		{
+			for(auto &t : i.tiles)
+				delete t;
+		}
+		built.clear();
+		requests.clear();
+		sectors.clear();
+		sectorsX = sectorsY = 0;
+		loadedBytes = 0;
+		updateCount = 0;
+		level = nullptr;
+	}
+
+	int GetLoadedSectorCount()
+	{
+		int count = 0;
+		for(auto &s : sectors)
+		{
+			if(s.state == SECTOR_LOADED)
+				count++;
+		}
+		return count;
+	}
+}
@@ -0,0 +1,24 @@
+#ifndef _streaming_h_
+#define _streaming_h_
+
+#include <SDL.h>
+
+class Level;
+
+// Keeps tiles created only around the camera. The level is split into square
+// sectors that get built on a background thread before the camera reaches them
+// and deleted again once far away and over the memory budget. Enemies and
+// pickups are spawned the first time their sector comes close to the area,
+// which is the virtual camera. It's the same size at any resolution, so
+// spawning doesn't depend on the display mode. Tiles are loaded around both
+// the area and the view.
+// Collision data stays loaded for the whole level.
+namespace Streaming
+{
+	void Start(Level &level, SDL_Rect area, SDL_Rect view);
+	void Update(SDL_Rect area, SDL_Rect view);
+	void Cleanup();
+	int GetLoadedSectorCount();
+}
+
+#endif
@@ -1,10 +1,13 @@
 #include "tiles.h"
 #include <SDL.h>
 #include <fstream>
+#include <functional>
+#include <queue>
 #include <sstream>
 #include <vector>
 #include "graphics.h"
 #include "level.h"
+#include "navigation.h"
 #include "utils.h"
 
 extern std::vector<std::vector<int>> tiles;
@@ -13,6 +16,20 @@ std::vector<TileLayerData> tileLayers;
 
 std::vector<CustomTile> tileset;
 
+// Texture coords of the frame currently shown by each tileset entry.
+// Static entries never change, animated ones are updated by the scheduler
+std::vector<SDL_Point> tileFrames;
+
+struct TileAnimationEvent
+{
+	Uint32 time;
+	int id;
+	bool operator>(const TileAnimationEvent &other) const { return time > other.time; }
+};
+
+// Animated tileset entries ordered by when their next frame is due
+std::priority_queue<TileAnimationEvent, std::vector<TileAnimationEvent>, std::greater<TileAnimationEvent>> tileAnimationQueue;
+
 void LoadTileSet()
 {
 	int width, height;
@@ -34,29 +51,31 @@ void AddDataToTileSet(int type, int x_offset, int y_offset)
 	tileset.push_back(c);
 }
 
-void DeleteAllTiles()
+// Deletes tile objects, the layers and their tile ids stay
+void UnloadTiles()
 {
 	for(auto &layer : tileLayers)
 	{
 		for(auto &i : layer.tiles)
 		{
-			for(auto &j : i)
+			if(i)
 			{
-				if(j)
-				{
-					delete j;
-					j = nullptr;
-				}
+				delete i;
+				i = nullptr;
 			}
 		}
 	}
+}
 
+void DeleteAllTiles()
+{
+	UnloadTiles();
 	tileLayers.clear();
 }
 
 Tile::Tile(int x, int y, int layer, CustomTile *data, bool replace)
 {
-	if(x >= (int)tileLayers[layer].tiles.size() || y >= (int)tileLayers[layer].tiles[0].size())
+	if(x >= tileLayers[layer].width || y >= tileLayers[layer].height)
 	{
 		PrintLog(LOG_IMPORTANT, "Attempted to place a tile outside of level boundaries: %d %d", x, y);
 		delete this;
@@ -69,7 +88,7 @@ Tile::Tile(int x, int y, int layer, CustomTile *data, bool replace)
 	this->tex_x = data->x_offset;
 	this->tex_y = data->y_offset;
 	src_tex = Graphics::GetLevelTexture();
-	animation = &data->animationData;
+	id = (int)(data - tileset.data());
 	customTile = data;
 	this->type = data->type;
 
@@ -82,17 +101,17 @@ Tile::Tile(int x, int y, int layer, CustomTile *data, bool replace)
 		}
 		else
 		{
-			delete tileLayers[layer].tiles[x][y];
+			delete tileLayers[layer].At(x, y);
 			tiles[x][y] = PHYSICS_UNOCCUPIED;
 		}
 	}
 	tiles[x][y] = type;
-	tileLayers[layer].tiles[x][y] = this;
+	tileLayers[layer].At(x, y) = this;
 }
 
 Tile::Tile(int x, int y, int layer, CustomTile *data, char type, bool replace)
 {
-	if(x >= (int)tileLayers[layer].tiles.size() || y >= (int)tileLayers[layer].tiles[0].size())
+	if(x >= tileLayers[layer].width || y >= tileLayers[layer].height)
 	{
 		PrintLog(LOG_IMPORTANT, "Attempted to place a tile outside of level boundaries: %d %d", x, y);
 		delete this;
@@ -105,7 +124,7 @@ Tile::Tile(int x, int y, int layer, CustomTile *data, char type, bool replace)
 	this->tex_x = data->x_offset;
 	this->tex_y = data->y_offset;	
 	src_tex = Graphics::GetLevelTexture();
-	animation = &data->animationData;
+	id = (int)(data - tileset.data());
 	customTile = data;
 	this->type = type;
 
@@ -118,16 +137,30 @@ Tile::Tile(int x, int y, int layer, CustomTile *data, char type, bool replace)
 		}
 		else
 		{
-			delete tileLayers[layer].tiles[x][y];
+			delete tileLayers[layer].At(x, y);
 			tiles[x][y] = PHYSICS_UNOCCUPIED;
 		}
 	}
 
 	tiles[x][y] = type;
-	tileLayers[layer].tiles[x][y] = this;
+	tileLayers[layer].At(x, y) = this;
 }
 
 
+// Not placed in the level yet, Streaming does that on the main thread
+Tile::Tile(int x, int y, int layer, CustomTile *data)
+{
+	this->x = x;
+	this->y = y;
+	this->layer = layer;
+	this->tex_x = data->x_offset;
+	this->tex_y = data->y_offset;
+	src_tex = Graphics::GetLevelTexture();
+	id = (int)(data - tileset.data());
+	customTile = data;
+	this->type = data->type;
+}
+
 int Tile::GetID()
 {
 	return (this->tex_y / TILESIZE) * 11 + this->tex_x / TILESIZE;
@@ -135,15 +168,54 @@ int Tile::GetID()
 
 bool Tile::HasAnimation()
 {
-	return !!(int)this->animation->sequence.size();
+	return !!(int)customTile->animationData.sequence.size();
+}
+
+int GetFrameDuration(TileAnimationData &animation)
+{
+	// a zero duration would keep the scheduler spinning on the same entry
+	return SDL_max(1, animation.sequence[animation.currentFrame].duration);
+}
+
+void SetTileFrame(int id)
+{
+	TileAnimationData &animation = tileset[id].animationData;
+	CustomTile &frame = tileset[animation.sequence[animation.currentFrame].id];
+	tileFrames[id] = { frame.x_offset, frame.y_offset };
 }
 
-void Tile::Animate()
+// Call once the tileset and its animations are loaded
+void InitTileAnimations(Uint32 time)
 {
-	if(HasAnimation())
+	tileFrames.resize(tileset.size());
+	tileAnimationQueue = decltype(tileAnimationQueue)();
+	for(int i = 0; i < (int)tileset.size(); i++)
 	{
-		tex_x = customTile->animated_x_offset;
-		tex_y = customTile->animated_y_offset;
+		tileFrames[i] = { tileset[i].x_offset, tileset[i].y_offset };
+		TileAnimationData &animation = tileset[i].animationData;
+		if(animation.sequence.empty())
+			continue;
+		animation.currentFrame = 0;
+		SetTileFrame(i);
+		tileAnimationQueue.push({ time + GetFrameDuration(animation), i });
+	}
+}
+
+// Only the entries whose frame is due are touched
+void UpdateTileAnimations(Uint32 time)
+{
+	while(!tileAnimationQueue.empty() && (Sint32)(time - tileAnimationQueue.top().time) >= 0)
+	{
+		TileAnimationEvent event = tileAnimationQueue.top();
+		tileAnimationQueue.pop();
+		TileAnimationData &animation = tileset[event.id].animationData;
+		animation.currentFrame++;
+		if(animation.currentFrame >= (int)animation.sequence.size())
+			animation.currentFrame = 0;
+		SetTileFrame(event.id);
+		// don't try to catch up on frames skipped during a long stall
+		Uint32 from = (time - event.time) > (Uint32)GetFrameDuration(animation) ? time : event.time;
+		tileAnimationQueue.push({ from + GetFrameDuration(animation), event.id });
 	}
 }
 
@@ -151,24 +223,36 @@ void TilesCleanup()
 {
 	tileLayers.~vector();
 	tileset.~vector();
+	std::vector<SDL_Point>().swap(tileFrames);
 }
 
+// Only takes the tile off the screen, it can get streamed in again
 Tile::~Tile()
 {
-	tileLayers[layer].tiles[x][y] = nullptr;
+	Tile *&slot = tileLayers[layer].At(x, y);
+	if(slot == this)
+		slot = nullptr;
+}
+
+// Removes a tile from the level for good, like a melted ice block
+void RemoveTile(Tile *tile)
+{
+	int x = tile->x;
+	int y = tile->y;
+	tileLayers[tile->layer].GidAt(x, y) = 0;
 	// Setting tile type of a tile below current one
-	bool foundTile = false;
-	for(int i = layer-1; i >= 0; i--)
+	tiles[x][y] = PHYSICS_AIR;
+	for(int i = tile->layer - 1; i >= 0; i--)
 	{
-		if(tileLayers[i].tiles[x][y] != nullptr)
+		Uint16 gid = tileLayers[i].GidAt(x, y);
+		if(gid)
 		{
-			tiles[x][y] = tileLayers[i].tiles[x][y]->type;
-			foundTile = true;
+			tiles[x][y] = tileset[gid - 1].type;
 			break;
 		}
 	}
-	if(!foundTile)
-		tiles[x][y] = PHYSICS_AIR;
+	Navigation::OnTileChanged(x, y);
+	delete tile;
 }
 
 PHYSICS_TYPES GetTileTypeAtTiledPos(int x, int y)
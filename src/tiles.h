@@ -6,10 +6,16 @@
 //#include <vld.h>
 #include "globals.h"
 
+class Tile;
+
 void LoadTileSet();
 void AddDataToTileSet(int type, int x_offset, int y_offset);
 void TilesCleanup();
+void InitTileAnimations(Uint32 time);
+void UpdateTileAnimations(Uint32 time);
+void UnloadTiles();
 void DeleteAllTiles();
+void RemoveTile(Tile *tile);
 PHYSICS_TYPES GetTileTypeAtTiledPos(int x, int y);
 PHYSICS_TYPES GetTileTypeAtTiledPos(SDL_Point at);
 PHYSICS_TYPES GetTileTypeAtPos(int x, int y);
@@ -27,16 +33,16 @@ class Tile
 		int tex_y;
 		// layer number
 		int layer;
+		// index in the tileset, current frame coords are looked up by it
+		int id;
 		// unique tile
 		CustomTile *customTile = nullptr;
-		// animation stuff
-		TileAnimationData *animation = nullptr;
 		SDL_Texture *src_tex;
 		Tile(int x, int y, int layer, CustomTile *data, bool replace);
 		Tile(int x, int y, int layer, CustomTile *data, char type, bool replace);
+		Tile(int x, int y, int layer, CustomTile *data);
 		int GetID();
 		bool HasAnimation();
-		void Animate();
 		~Tile();
 };
 
@@ -46,7 +52,35 @@ struct TileLayerData
 	int parallaxOffsetY = 0;
 	double parallaxDepthX = 1;
 	double parallaxDepthY = 1;
-	std::vector<std::vector<Tile*>> tiles;
+	// size in tiles
+	int width = 0;
+	int height = 0;
+	// column by column, so walking down a column is a straight memory walk
+	std::vector<Tile*> tiles;
+	// tileset index + 1 of every tile of the layer, 0 for none.
+	// Tiles are only created around the camera, see Streaming
+	std::vector<Uint16> gids;
+
+	void Resize(int width, int height)
+	{
+		this->width = width;
+		this->height = height;
+		tiles.assign(width * height, nullptr);
+		gids.assign(width * height, 0);
+	}
+	Tile*& At(int x, int y)
+	{
+		return tiles[x * height + y];
+	}
+	Uint16& GidAt(int x, int y)
+	{
+		return gids[x * height + y];
+	}
+	// parallax layers show other tiles than the camera is over, so they're loaded whole
+	bool IsStreamed() const
+	{
+		return parallaxDepthX == 1 && parallaxDepthY == 1 && parallaxOffsetX == 0 && parallaxOffsetY == 0;
+	}
 };
 
 #endif
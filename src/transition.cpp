@@ -5,6 +5,7 @@
 #include "level.h"
 #include "menu.h"
 #include "input.h"
+#include "preloader.h"
 
 TRANSITIONS TransitionID;
 
@@ -13,6 +14,9 @@ void ProgressTransition()
 	switch(TransitionID)
 	{
 		case TRANSITION_TITLE:
+			// stay on the title screen until everything is loaded
+			if(!Preloader::IsDone())
+				return;
 			Game::ChangeState(STATE_MENU);
 			SetCurrentMenu(MENU_MAIN);
 			break;
@@ -25,7 +25,9 @@ RandomGenerator::RandomGenerator()
 
 void RandomGenerator::SetSeed(int seed)
 {
-	gen.seed(seed);
+	gen.engine.seed(seed);
+	gen.seed = seed;
+	gen.draws = 0;
 }
 
 void RandomGenerator::ExportSeed()
@@ -64,6 +66,21 @@ void RandomGenerator::ResetSequence()
 	SetSeed(seed);
 }
 
+RandomState RandomGenerator::GetState()
+{
+	return { seed, seedBackup, gen.seed, gen.draws };
+}
+
+// Seeds the engine again and skips what was drawn
+void RandomGenerator::SetState(const RandomState &state)
+{
+	seed = state.seed;
+	seedBackup = state.seedBackup;
+	SetSeed(state.genSeed);
+	gen.engine.discard(state.draws);
+	gen.draws = state.draws;
+}
+
 int RandomGenerator::Generate(int from, int to)
 {
 	std::uniform_int_distribution<> dis(from, to);
@@ -175,6 +192,30 @@ bool GetFolderFileList(std::string folder, std::vector<std::string> &fileList)
 	return 1;
 }
 
+bool ReadFileData(std::string file, std::vector<char> &data)
+{
+	SDL_RWops *rw = SDL_RWFromFile(file.c_str(), "rb");
+	if(!rw)
+		return false;
+	Sint64 size = SDL_RWsize(rw);
+	if(size > 0)
+	{
+		data.resize((size_t)size);
+		if(SDL_RWread(rw, data.data(), 1, (size_t)size) != (size_t)size)
+			data.clear();
+	}
+	SDL_RWclose(rw);
+	return !data.empty();
+}
+
+Uint32 HashData(const char *data, size_t size)
+{
+	Uint32 hash = 2166136261u;
+	for(size_t i = 0; i < size; i++)
+		hash = (hash ^ (Uint8)data[i]) * 16777619u;
+	return hash;
+}
+
 bool HasIntersection(PrecisionRect *a, PrecisionRect *b)
 {
 	if((a->x > (b->x + b->w)) || (b->x > (a->x + a->w)))
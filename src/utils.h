@@ -13,7 +13,10 @@ class Timer
 		Uint32 oldTicks;
 		void Run()
 		{
-			Uint32 newTicks = SDL_GetTicks();
+			Run(SDL_GetTicks());
+		};
+		void Run(Uint32 newTicks)
+		{
 			completed = false;
 			if(newTicks - oldTicks > period)
 			{
@@ -23,12 +26,33 @@ class Timer
 		};
 };
 
+// Where a generator is in its sequence, for save states
+struct RandomState
+{
+	int seed;
+	int seedBackup;
+	int genSeed;
+	Uint64 draws;
+};
+
 class RandomGenerator
 {
 	private:
+		// Counts the numbers drawn since seeding, so the whole state is
+		// the seed and a count instead of the engine's few kilobytes
+		struct CountingEngine
+		{
+			typedef std::mt19937::result_type result_type;
+			std::mt19937 engine;
+			int seed = 0;
+			Uint64 draws = 0;
+			static constexpr result_type min() { return std::mt19937::min(); };
+			static constexpr result_type max() { return std::mt19937::max(); };
+			result_type operator()() { draws++; return engine(); };
+		};
 		int seed;
 		int seedBackup;
-		std::mt19937 gen;
+		CountingEngine gen;
 
 	public:
 		RandomGenerator();
@@ -39,6 +63,8 @@ class RandomGenerator
 		void LoadSeed();
 		void ResetSequence();
 		int Generate(int from, int to);
+		RandomState GetState();
+		void SetState(const RandomState &state);
 };
 
 template < class ContainerT >
@@ -82,6 +108,9 @@ std::string IntToString(int var);
 std::string AddLeadingZeroes(int var, int length);
 void PrintLog(int logLevel, const char *fmt, ...);
 bool GetFolderFileList(std::string folder, std::vector<std::string> &fileList);
+bool ReadFileData(std::string file, std::vector<char> &data);
+// FNV-1a
+Uint32 HashData(const char *data, size_t size);
 bool HasIntersection(PrecisionRect *a, PrecisionRect *b);
 template<typename T>
 void CleanFromNullPointers(std::vector<T> *collection)
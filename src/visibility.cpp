@@ -0,0 +1,129 @@
+#include "visibility.h"
+#include <algorithm>
+#include "utils.h"
+
+extern std::vector<Bullet*> bullets;
+extern std::vector<Effect*> effects;
+extern std::vector<Creature*> creatures;
+extern std::vector<Pickup*> pickups;
+extern std::vector<Machinery*> machinery;
+extern std::vector<Lightning*> lightnings;
+
+namespace Visibility
+{
+	int const COLUMN_WIDTH = 256;
+	// extra space around the view for hitboxes sticking out of their sprites
+	int const VIEW_MARGIN = 32;
+
+	SDL_Rect viewRect = { 0, 0, 0, 0 };
+	VisibleEntities visible;
+
+	// every pickup is listed in all the columns its sprite overlaps
+	std::vector<std::vector<Pickup*>> pickupColumns;
+	bool pickupsDirty = true;
+
+	SDL_Rect GetBounds(Entity &e)
+	{
+		double x, y;
+		e.GetPos(x, y);
+		SDL_Rect tex = e.sprite->GetTextureCoords();
+		return { (int)x + e.sprite->GetSpriteOffsetX(), (int)y + e.sprite->GetSpriteOffsetY(), tex.w, tex.h };
+	}
+
+	int GetColumn(int x)
+	{
+		return std::max(0, x / COLUMN_WIDTH);
+	}
+
+	void BuildPickupColumns()
+	{
+		for(auto &i : pickupColumns)
+			i.clear();
+		for(auto &p : pickups)
+		{
+			SDL_Rect bounds = GetBounds(*p);
+			int last = GetColumn(bounds.x + bounds.w);
+			if(last >= (int)pickupColumns.size())
+				pickupColumns.resize(last + 1);
+			for(int i = GetColumn(bounds.x); i <= last; i++)
+				pickupColumns[i].push_back(p);
+		}
+		pickupsDirty = false;
+	}
+
+	void CollectPickups()
+	{
+		if(pickupsDirty)
+			BuildPickupColumns();
+		if(pickupColumns.empty())
+			return;
+		int first = GetColumn(viewRect.x);
+		int last = std::min(GetColumn(viewRect.x + viewRect.w), (int)pickupColumns.size() - 1);
+		for(int i = first; i <= last; i++)
+		{
+			for(auto &p : pickupColumns[i])
+			{
+				// pickups spanning several columns are only taken from the first one in view
+				if(i != first && GetColumn(GetBounds(*p).x) != i)
+					continue;
+				if(IsVisible(*p))
+					visible.pickups.push_back(p);
+			}
+		}
+	}
+
+	template <class T>
+	void Collect(std::vector<T*> &from, std::vector<T*> &to)
+	{
+		for(auto &i : from)
+		{
+			if(IsVisible(*i))
+				to.push_back(i);
+		}
+	}
+
+	// view is in level coordinates
+	void Update(SDL_Rect view)
+	{
+		viewRect = { view.x - VIEW_MARGIN, view.y - VIEW_MARGIN, view.w + VIEW_MARGIN * 2, view.h + VIEW_MARGIN * 2 };
+
+		visible.machinery.clear();
+		visible.pickups.clear();
+		visible.creatures.clear();
+		visible.lightnings.clear();
+		visible.effects.clear();
+		visible.bullets.clear();
+
+		Collect(machinery, visible.machinery);
+		CollectPickups();
+		Collect(creatures, visible.creatures);
+		Collect(lightnings, visible.lightnings);
+		Collect(effects, visible.effects);
+		Collect(bullets, visible.bullets);
+	}
+
+	bool IsVisible(Entity &e)
+	{
+		// zero sized sprites still count, unlike with SDL_HasIntersection
+		SDL_Rect bounds = GetBounds(e);
+		return bounds.x <= viewRect.x + viewRect.w && bounds.x + bounds.w >= viewRect.x &&
+			bounds.y <= viewRect.y + viewRect.h && bounds.y + bounds.h >= viewRect.y;
+	}
+
+	VisibleEntities& GetVisible()
+	{
+		return visible;
+	}
+
+	void InvalidatePickups()
+	{
+		pickupsDirty = true;
+	}
+
+	void Cleanup()
+	{
+		std::vector<std::vector<Pickup*>>().swap(pickupColumns);
+		visible = VisibleEntities();
+		pickupsDirty = true;
+	}
+}
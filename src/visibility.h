@@ -0,0 +1,30 @@
+#ifndef _visibility_h_
+#define _visibility_h_
+
+#include <SDL.h>
+#include <vector>
+#include "entities.h"
+
+// Entities that ended up on screen this frame
+struct VisibleEntities
+{
+	std::vector<Machinery*> machinery;
+	std::vector<Pickup*> pickups;
+	std::vector<Creature*> creatures;
+	std::vector<Lightning*> lightnings;
+	std::vector<Effect*> effects;
+	std::vector<Bullet*> bullets;
+};
+
+// Culls entities against the camera so only visible ones get animated and drawn.
+// Pickups never move, so they are kept in a column index instead of being tested one by one
+namespace Visibility
+{
+	void Update(SDL_Rect view);
+	bool IsVisible(Entity &e);
+	VisibleEntities& GetVisible();
+	void InvalidatePickups();
+	void Cleanup();
+}
+
+#endif